@@ -0,0 +1,174 @@
+#include "ArchiveBackend.h"
+#include "ScanProfiler.h"
+
+ArchiveBackend::ArchiveBackend(std::unique_ptr<FileSystemBackend> inner)
+    : FileSystemBackend(false), inner(std::move(inner))
+{
+}
+
+bool ArchiveBackend::locate(const QString &path, Location &location)
+{
+    // 从左到右找第一个名称像压缩包、实际又是文件的路径分量；名称像压缩包的目录照常进入
+    int start = 0;
+    while (start <= path.size()) {
+        int end = path.indexOf('/', start);
+        if (end < 0) {
+            end = path.size();
+        }
+        if (end > start && ArchiveIndex::isArchiveName(path.midRef(start, end - start))) {
+            const QString prefix = path.left(end);
+            DirEntry archive;
+            if (inner->statEntry(prefix, archive) && !archive.isDir()) {
+                location.archivePath = prefix;
+                location.archive = archive;
+                location.innerPath = path.mid(end + 1);
+                return true;
+            }
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+int ArchiveBackend::findNode(const Location &location, std::shared_ptr<const ArchiveIndex> &index)
+{
+    // 扫描期间压缩包被修改时沿用第一次读到的结构，与扫描其他目录时的快照语义一致
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        index = scanning ? pinned.value(location.archivePath) : nullptr;
+    }
+    if (!index) {
+        index = ArchiveCache::instance().get(location.archivePath, location.archive.size, location.archive.modifiedTime);
+        std::lock_guard<std::mutex> lock(pinMutex);
+        if (index && scanning) {
+            pinned.insert(location.archivePath, index);
+        }
+    }
+    return index ? index->find(location.innerPath) : -1;
+}
+
+void ArchiveBackend::beginScan()
+{
+    inner->beginScan();
+    std::lock_guard<std::mutex> lock(pinMutex);
+    scanning = true;
+}
+
+void ArchiveBackend::endScan()
+{
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        scanning = false;
+        pinned.clear();
+    }
+    inner->endScan();
+}
+
+void ArchiveBackend::markArchive(DirEntry &entry)
+{
+    entry.type = EntryType::DIRECTORY;
+    entry.archive = true;
+}
+
+void ArchiveBackend::fillEntry(const ArchiveIndex &index, int node, DirEntry &entry)
+{
+    const ArchiveIndex::Node &item = index.node(node);
+    entry.name = item.name;
+    entry.type = item.dir ? EntryType::DIRECTORY : EntryType::FILE;
+    entry.hidden = item.name.startsWith('.');
+    entry.modifiedTime = item.modifiedTime;
+    entry.size = item.dir ? 0 : item.size;
+    entry.allocatedSize = item.dir ? 0 : item.compressedSize;
+    entry.linkCount = 1;
+    entry.hasMetadata = true;
+}
+
+bool ArchiveBackend::listDirectory(const QString &path, bool showHidden, bool needMetadata,
+                                   QVector<DirEntry> &entries)
+{
+    Location location;
+    if (!locate(path, location)) {
+        if (!inner->listDirectory(path, showHidden, needMetadata, entries)) {
+            return false;
+        }
+        for (DirEntry &entry : entries) {
+            if (!entry.isDir() && ArchiveIndex::isArchiveName(entry.name)) {
+                markArchive(entry);
+            }
+        }
+        return true;
+    }
+
+    std::shared_ptr<const ArchiveIndex> index;
+    int node;
+    {
+        // 第一次进入压缩包时读取其目录结构，之后的子目录都从缓存中取得
+        ProfileScope listScope(ProfilePhase::LIST);
+        node = findNode(location, index);
+    }
+    if (node < 0 || !index->node(node).dir) {
+        return false;
+    }
+
+    // 条目的元数据都在目录结构中，不需要 stat，needMetadata 为 false 时也一并给出
+    const QVector<int> &children = index->node(node).children;
+    ProfileScope stringsScope(ProfilePhase::STRINGS, children.size());
+    entries.reserve(entries.size() + children.size());
+    for (int child : children) {
+        DirEntry entry;
+        fillEntry(*index, child, entry);
+        if (entry.hidden && !showHidden) {
+            continue;
+        }
+        entries.append(entry);
+    }
+    return true;
+}
+
+bool ArchiveBackend::directoryModifiedTime(const QString &path, qint64 &modifiedTime, FileId *id)
+{
+    Location location;
+    if (!locate(path, location)) {
+        return inner->directoryModifiedTime(path, modifiedTime, id);
+    }
+
+    // 压缩包内的目录都使用压缩包的修改时间：压缩包变化时其中所有目录都重新列出
+    if (!location.innerPath.isEmpty()) {
+        std::shared_ptr<const ArchiveIndex> index;
+        int node = findNode(location, index);
+        if (node < 0 || !index->node(node).dir) {
+            return false;
+        }
+    }
+    modifiedTime = location.archive.modifiedTime;
+    if (id) {
+        // 压缩包内的目录没有 inode，但和压缩包在同一设备上，只扫描一个文件系统时不会被当作挂载点
+        id->device = location.archive.id.device;
+        id->inode = location.innerPath.isEmpty() ? location.archive.id.inode : 0;
+    }
+    return true;
+}
+
+bool ArchiveBackend::statEntry(const QString &path, DirEntry &entry)
+{
+    Location location;
+    if (!locate(path, location)) {
+        return inner->statEntry(path, entry);
+    }
+
+    // 压缩包本身报告为目录，使它可以作为扫描的根
+    if (location.innerPath.isEmpty()) {
+        entry = location.archive;
+        markArchive(entry);
+        return true;
+    }
+
+    std::shared_ptr<const ArchiveIndex> index;
+    int node = findNode(location, index);
+    if (node < 0) {
+        return false;
+    }
+    fillEntry(*index, node, entry);
+    entry.id.device = location.archive.id.device;
+    return true;
+}
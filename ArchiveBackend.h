@@ -0,0 +1,50 @@
+#ifndef ARCHIVEBACKEND_H
+#define ARCHIVEBACKEND_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include <mutex>
+#include "ArchiveIndex.h"
+#include "FileSystemBackend.h"
+
+// 把压缩包当作目录的扫描后端：包装另一个后端，压缩包以外的路径原样转交给它，
+// 列出时把名称像压缩包的文件报告为目录（archive 为 true），压缩包内的路径由 ArchiveCache 中的目录结构回答。
+// 压缩包内的条目没有 inode，修改时间取条目自身记录的时间；压缩包中不能再嵌套浏览压缩包
+class ArchiveBackend : public FileSystemBackend
+{
+public:
+    explicit ArchiveBackend(std::unique_ptr<FileSystemBackend> inner);
+
+    bool listDirectory(const QString &path, bool showHidden, bool needMetadata,
+                       QVector<DirEntry> &entries) override;
+    bool directoryModifiedTime(const QString &path, qint64 &modifiedTime, FileId *id = nullptr) override;
+    bool statEntry(const QString &path, DirEntry &entry) override;
+    void beginScan() override;
+    void endScan() override;
+
+private:
+    // 路径落在某个压缩包内（或就是压缩包本身）时的解析结果
+    struct Location {
+        QString archivePath;
+        DirEntry archive;       // 压缩包文件自身的元数据
+        QString innerPath;      // 压缩包内的路径，空字符串为压缩包本身
+    };
+
+    std::unique_ptr<FileSystemBackend> inner;
+    // 扫描期间用过的目录结构留在这里，压缩包的每个子目录都不必再经过 ArchiveCache，
+    // 同时扫描的压缩包超过缓存上限时也不会被淘汰后反复重新读取
+    std::mutex pinMutex;
+    bool scanning = false;
+    QHash<QString, std::shared_ptr<const ArchiveIndex>> pinned;
+
+    // 路径不经过任何压缩包时返回 false，由内层后端处理
+    bool locate(const QString &path, Location &location);
+    // 读取（或从缓存取得）压缩包的目录结构，找到 innerPath 对应的条目。失败时返回 -1
+    int findNode(const Location &location, std::shared_ptr<const ArchiveIndex> &index);
+    static void markArchive(DirEntry &entry);
+    static void fillEntry(const ArchiveIndex &index, int node, DirEntry &entry);
+};
+
+#endif // ARCHIVEBACKEND_H
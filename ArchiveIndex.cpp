@@ -0,0 +1,660 @@
+#include "ArchiveIndex.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+#include <cstring>
+
+#ifdef DTV_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+const qint64 TAR_BLOCK = 512;
+const int ZIP_EOCD_SIZE = 22;
+const int ZIP_MAX_COMMENT = 0xFFFF;
+const int ZIP_CENTRAL_HEADER_SIZE = 46;
+
+quint16 le16(const uchar *data) { return qFromLittleEndian<quint16>(data); }
+quint32 le32(const uchar *data) { return qFromLittleEndian<quint32>(data); }
+quint64 le64(const uchar *data) { return qFromLittleEndian<quint64>(data); }
+
+// zip 中的 MS-DOS 日期时间（本地时间，精度 2 秒）
+qint64 dosTimeToMSecs(quint16 time, quint16 date)
+{
+    QDate day(1980 + (date >> 9), (date >> 5) & 0x0F, date & 0x1F);
+    QTime clock((time >> 11) & 0x1F, (time >> 5) & 0x3F, (time & 0x1F) * 2);
+    if (!day.isValid() || !clock.isValid()) {
+        return 0;
+    }
+    return QDateTime(day, clock).toMSecsSinceEpoch();
+}
+
+// 去掉开头的 ./ 和 /，以及末尾的 /
+QString normalizedEntryPath(QString path)
+{
+    while (path.startsWith(QLatin1String("./")) || path.startsWith('/')) {
+        path.remove(0, path.startsWith('/') ? 1 : 2);
+    }
+    while (path.endsWith('/')) {
+        path.chop(1);
+    }
+    return path == "." ? QString() : path;
+}
+
+// tar 头部中的数值字段：通常为八进制文本，GNU 扩展对大数值使用以 0x80 开头的大端二进制
+qint64 tarNumber(const char *field, int length)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(field);
+    if (bytes[0] & 0x80) {
+        qint64 value = bytes[0] & 0x7F;
+        for (int i = 1; i < length; ++i) {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    qint64 value = 0;
+    int i = 0;
+    while (i < length && (field[i] == ' ' || field[i] == '\0')) {
+        ++i;
+    }
+    for (; i < length && field[i] >= '0' && field[i] <= '7'; ++i) {
+        value = value * 8 + (field[i] - '0');
+    }
+    return value;
+}
+
+QString tarString(const char *field, int length)
+{
+    return QString::fromUtf8(field, int(strnlen(field, size_t(length))));
+}
+
+bool tarChecksumValid(const char *header)
+{
+    qint64 expected = tarNumber(header + 148, 8);
+    qint64 sum = 0;
+    for (int i = 0; i < TAR_BLOCK; ++i) {
+        sum += (i >= 148 && i < 156) ? ' ' : uchar(header[i]);
+    }
+    return sum == expected;
+}
+
+// tar 条目的读取来源：读出头部，跳过数据
+class TarSource
+{
+public:
+    virtual ~TarSource() = default;
+    // 读满 length 字节，到达末尾或出错时返回 false
+    virtual bool read(char *data, qint64 length) = 0;
+    virtual bool skip(qint64 length) = 0;
+    virtual QString errorString() const = 0;
+};
+
+// 未压缩的 tar：数据块直接定位跳过，不读取
+class FileTarSource : public TarSource
+{
+public:
+    explicit FileTarSource(QFile &file) : file(file) {}
+
+    bool read(char *data, qint64 length) override { return file.read(data, length) == length; }
+    bool skip(qint64 length) override { return file.seek(file.pos() + length); }
+    QString errorString() const override { return file.errorString(); }
+
+private:
+    QFile &file;
+};
+
+#ifdef DTV_HAVE_ZLIB
+// gzip 压缩的 tar：只能顺序解压，跳过的数据解压到丢弃缓冲区。支持多个 gzip 成员首尾相接
+class GzipTarSource : public TarSource
+{
+public:
+    explicit GzipTarSource(QFile &file) : file(file), input(64 * 1024, '\0'), discard(64 * 1024, '\0')
+    {
+        memset(&stream, 0, sizeof(stream));
+        // 32 表示自动识别 gzip 头部
+        ok = inflateInit2(&stream, 15 + 32) == Z_OK;
+    }
+    ~GzipTarSource() override
+    {
+        if (ok) {
+            inflateEnd(&stream);
+        }
+    }
+
+    bool read(char *data, qint64 length) override
+    {
+        while (length > 0) {
+            qint64 produced = inflateInto(data, length);
+            if (produced <= 0) {
+                return false;
+            }
+            data += produced;
+            length -= produced;
+        }
+        return true;
+    }
+
+    bool skip(qint64 length) override
+    {
+        while (length > 0) {
+            qint64 produced = inflateInto(discard.data(), qMin<qint64>(length, discard.size()));
+            if (produced <= 0) {
+                return false;
+            }
+            length -= produced;
+        }
+        return true;
+    }
+
+    QString errorString() const override { return error.isEmpty() ? file.errorString() : error; }
+
+private:
+    QFile &file;
+    QByteArray input;
+    QByteArray discard;
+    z_stream stream;
+    bool ok;
+    QString error;
+
+    qint64 inflateInto(char *data, qint64 length)
+    {
+        if (!ok) {
+            error = "无法初始化 zlib";
+            return -1;
+        }
+        const uInt chunk = uInt(qMin<qint64>(length, 1 << 30));
+        stream.next_out = reinterpret_cast<Bytef *>(data);
+        stream.avail_out = chunk;
+        while (stream.avail_out == chunk) {
+            if (stream.avail_in == 0) {
+                qint64 bytes = file.read(input.data(), input.size());
+                if (bytes <= 0) {
+                    return -1;
+                }
+                stream.next_in = reinterpret_cast<Bytef *>(input.data());
+                stream.avail_in = uInt(bytes);
+            }
+            int status = inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                // 下一个 gzip 成员（如果有）从剩余的输入继续
+                inflateReset(&stream);
+            } else if (status != Z_OK && status != Z_BUF_ERROR) {
+                error = stream.msg ? QString::fromLatin1(stream.msg) : QString("gzip 数据损坏");
+                return -1;
+            }
+        }
+        return chunk - stream.avail_out;
+    }
+};
+#endif
+
+}
+
+bool ArchiveIndex::isArchiveName(const QStringRef &name)
+{
+    if (name.endsWith(QLatin1String(".zip"), Qt::CaseInsensitive)
+            || name.endsWith(QLatin1String(".tar"), Qt::CaseInsensitive)) {
+        return true;
+    }
+#ifdef DTV_HAVE_ZLIB
+    return name.endsWith(QLatin1String(".tar.gz"), Qt::CaseInsensitive)
+            || name.endsWith(QLatin1String(".tgz"), Qt::CaseInsensitive);
+#else
+    return false;
+#endif
+}
+
+std::shared_ptr<const ArchiveIndex> ArchiveIndex::read(const QString &fileName, QString *errorString)
+{
+    auto index = std::make_shared<ArchiveIndex>();
+    index->archiveModifiedTime = QFileInfo(fileName).lastModified().toMSecsSinceEpoch();
+    Node root;
+    root.dir = true;
+    root.modifiedTime = index->archiveModifiedTime;
+    index->nodes.append(root);
+    index->directories.insert(QString(), 0);
+
+    QString error;
+    bool ok;
+    if (fileName.endsWith(QLatin1String(".zip"), Qt::CaseInsensitive)) {
+        ok = index->readZip(fileName, error);
+    } else {
+        ok = index->readTar(fileName, !fileName.endsWith(QLatin1String(".tar"), Qt::CaseInsensitive), error);
+    }
+    index->files = QHash<QString, int>();
+    if (!ok) {
+        if (errorString) {
+            *errorString = error;
+        }
+        return nullptr;
+    }
+    return index;
+}
+
+int ArchiveIndex::find(const QString &innerPath) const
+{
+    const QString path = normalizedEntryPath(innerPath);
+    auto it = directories.constFind(path);
+    if (it != directories.constEnd()) {
+        return it.value();
+    }
+
+    int slash = path.lastIndexOf('/');
+    int parent = directories.value(slash < 0 ? QString() : path.left(slash), -1);
+    if (parent < 0) {
+        return -1;
+    }
+    const QStringRef name = path.midRef(slash + 1);
+    for (int child : nodes[parent].children) {
+        if (nodes[child].name == name) {
+            return child;
+        }
+    }
+    return -1;
+}
+
+size_t ArchiveIndex::memoryUsage() const
+{
+    size_t bytes = size_t(nodes.capacity()) * sizeof(Node) + size_t(directories.capacity()) * 2 * sizeof(void *);
+    for (const Node &node : nodes) {
+        bytes += size_t(node.name.capacity()) * sizeof(QChar) + size_t(node.children.capacity()) * sizeof(int);
+    }
+    return bytes;
+}
+
+int ArchiveIndex::ensureDirectory(const QString &path)
+{
+    auto it = directories.constFind(path);
+    if (it != directories.constEnd()) {
+        return it.value();
+    }
+
+    int slash = path.lastIndexOf('/');
+    int parent = slash < 0 ? 0 : ensureDirectory(path.left(slash));
+
+    Node node;
+    node.name = path.mid(slash + 1);
+    node.parent = parent;
+    node.dir = true;
+    node.modifiedTime = archiveModifiedTime;
+    int index = nodes.size();
+    nodes.append(node);
+    nodes[parent].children.append(index);
+    directories.insert(path, index);
+    return index;
+}
+
+void ArchiveIndex::addEntry(QString path, bool dir, qint64 size, qint64 compressedSize, qint64 modifiedTime)
+{
+    path = normalizedEntryPath(path);
+    if (path.isEmpty()) {
+        return;
+    }
+
+    if (dir) {
+        nodes[ensureDirectory(path)].modifiedTime = modifiedTime;
+        return;
+    }
+
+    // 同一路径出现多次（tar 追加更新）时以最后一次为准。按路径哈希查找，
+    // 不在同级条目中逐个比较名称，否则大目录的读取是平方级的
+    auto existing = files.constFind(path);
+    if (existing != files.constEnd()) {
+        Node &node = nodes[existing.value()];
+        node.size = size;
+        node.compressedSize = compressedSize;
+        node.modifiedTime = modifiedTime;
+        return;
+    }
+
+    int slash = path.lastIndexOf('/');
+    int parent = slash < 0 ? 0 : ensureDirectory(path.left(slash));
+    Node node;
+    node.name = path.mid(slash + 1);
+    node.parent = parent;
+    node.size = size;
+    node.compressedSize = compressedSize;
+    node.modifiedTime = modifiedTime;
+    int index = nodes.size();
+    nodes.append(node);
+    nodes[parent].children.append(index);
+    files.insert(path, index);
+}
+
+bool ArchiveIndex::readZip(const QString &fileName, QString &error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+
+    // 末尾的目录结束记录之后最多还有 64 KB 的注释，从后向前找它的签名
+    const qint64 fileSize = file.size();
+    const qint64 tailSize = qMin<qint64>(fileSize, ZIP_EOCD_SIZE + ZIP_MAX_COMMENT);
+    if (tailSize < ZIP_EOCD_SIZE || !file.seek(fileSize - tailSize)) {
+        error = "不是 zip 文件";
+        return false;
+    }
+    const QByteArray tail = file.read(tailSize);
+    const uchar *tailData = reinterpret_cast<const uchar *>(tail.constData());
+    int eocd = -1;
+    for (int i = tail.size() - ZIP_EOCD_SIZE; i >= 0; --i) {
+        if (le32(tailData + i) == 0x06054b50) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0) {
+        error = "找不到 zip 中央目录";
+        return false;
+    }
+
+    quint64 entryCount = le16(tailData + eocd + 10);
+    quint64 directorySize = le32(tailData + eocd + 12);
+    quint64 directoryOffset = le32(tailData + eocd + 16);
+
+    // Zip64：目录结束记录前紧挨着 Zip64 定位记录，指向 64 位的目录结束记录
+    if ((entryCount == 0xFFFF || directorySize == 0xFFFFFFFFu || directoryOffset == 0xFFFFFFFFu)
+            && eocd >= 20 && le32(tailData + eocd - 20) == 0x07064b50) {
+        quint64 zip64Offset = le64(tailData + eocd - 20 + 8);
+        QByteArray record;
+        if (file.seek(qint64(zip64Offset))) {
+            record = file.read(56);
+        }
+        const uchar *recordData = reinterpret_cast<const uchar *>(record.constData());
+        if (record.size() < 56 || le32(recordData) != 0x06064b50) {
+            error = "Zip64 目录结束记录损坏";
+            return false;
+        }
+        entryCount = le64(recordData + 32);
+        directorySize = le64(recordData + 40);
+        directoryOffset = le64(recordData + 48);
+    }
+
+    if (directoryOffset + directorySize > quint64(fileSize) || !file.seek(qint64(directoryOffset))) {
+        error = "zip 中央目录越界";
+        return false;
+    }
+    // 中央目录只有每个条目的元数据，一次读入
+    const QByteArray directory = file.read(qint64(directorySize));
+    if (quint64(directory.size()) != directorySize) {
+        error = file.errorString();
+        return false;
+    }
+
+    // 条目数来自文件本身，不能信任：每个条目至少占一个中央目录头，按已读入的中央目录大小限定预留的空间
+    nodes.reserve(int(qMin<quint64>(entryCount, directorySize / ZIP_CENTRAL_HEADER_SIZE)) + 1);
+    const uchar *data = reinterpret_cast<const uchar *>(directory.constData());
+    const uchar *end = data + directory.size();
+    for (quint64 i = 0; i < entryCount; ++i) {
+        if (end - data < ZIP_CENTRAL_HEADER_SIZE || le32(data) != 0x02014b50) {
+            error = "zip 中央目录损坏";
+            return false;
+        }
+        const quint16 madeBy = le16(data + 4);
+        const quint16 flags = le16(data + 8);
+        const quint16 time = le16(data + 12);
+        const quint16 date = le16(data + 14);
+        quint64 compressedSize = le32(data + 20);
+        quint64 size = le32(data + 24);
+        const int nameLength = le16(data + 28);
+        const int extraLength = le16(data + 30);
+        const int commentLength = le16(data + 32);
+        const quint32 externalAttributes = le32(data + 38);
+        const uchar *name = data + ZIP_CENTRAL_HEADER_SIZE;
+        const uchar *extra = name + nameLength;
+        if (end - name < qint64(nameLength) + extraLength + commentLength) {
+            error = "zip 中央目录损坏";
+            return false;
+        }
+
+        // Zip64 扩展字段按顺序只包含 32 位字段放不下的值
+        for (const uchar *field = extra; field + 4 <= extra + extraLength;) {
+            const quint16 id = le16(field);
+            const quint16 length = le16(field + 2);
+            const uchar *value = field + 4;
+            if (value + length > extra + extraLength) {
+                break;
+            }
+            if (id == 0x0001) {
+                const uchar *next = value;
+                if (size == 0xFFFFFFFFu && next + 8 <= value + length) {
+                    size = le64(next);
+                    next += 8;
+                }
+                if (compressedSize == 0xFFFFFFFFu && next + 8 <= value + length) {
+                    compressedSize = le64(next);
+                }
+            }
+            field = value + length;
+        }
+
+        // 第 11 位表示名称为 UTF-8，否则是压缩工具所在系统的代码页
+        const char *nameData = reinterpret_cast<const char *>(name);
+        const QString path = (flags & 0x0800) ? QString::fromUtf8(nameData, nameLength)
+                                              : QString::fromLocal8Bit(nameData, nameLength);
+        // Unix 上创建的压缩包在外部属性的高 16 位保存文件类型，符号链接与扫描磁盘时一样跳过
+        const quint32 unixMode = (madeBy >> 8) == 3 ? externalAttributes >> 16 : 0;
+        const bool symlink = (unixMode & 0170000) == 0120000;
+        if (!symlink) {
+            addEntry(path, path.endsWith('/'), qint64(size), qint64(compressedSize), dosTimeToMSecs(time, date));
+        }
+
+        data = name + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+
+bool ArchiveIndex::readTar(const QString &fileName, bool gzip, QString &error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+
+    std::unique_ptr<TarSource> source;
+    if (gzip) {
+#ifdef DTV_HAVE_ZLIB
+        source = std::make_unique<GzipTarSource>(file);
+#else
+        error = "构建时没有 zlib，不支持 gzip 压缩的 tar";
+        return false;
+#endif
+    } else {
+        source = std::make_unique<FileTarSource>(file);
+    }
+
+    char header[TAR_BLOCK];
+    QString longName;       // GNU 长名称（'L'）或 pax 的 path，作用于下一个条目
+    qint64 paxSize = -1;
+    qint64 paxTime = -1;
+    bool first = true;
+    while (source->read(header, TAR_BLOCK)) {
+        // 全零的块表示结束
+        bool empty = true;
+        for (int i = 0; i < TAR_BLOCK && empty; ++i) {
+            empty = header[i] == '\0';
+        }
+        if (empty) {
+            return true;
+        }
+        if (!tarChecksumValid(header)) {
+            error = first ? QString("不是 tar 文件") : QString("tar 头部校验和错误");
+            return false;
+        }
+        first = false;
+
+        const char type = header[156];
+        const qint64 size = tarNumber(header + 124, 12);
+        const qint64 padded = (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+
+        // 长名称和 pax 扩展头部本身很小，是唯一需要读取的数据块
+        if (type == 'L' || type == 'x') {
+            QByteArray data(int(qMin<qint64>(padded, 1 << 20)), '\0');
+            if (padded > data.size() || !source->read(data.data(), padded)) {
+                error = "tar 扩展头部损坏";
+                return false;
+            }
+            data.truncate(int(size));
+            if (type == 'L') {
+                longName = QString::fromUtf8(data.constData(), int(strnlen(data.constData(), size_t(data.size()))));
+                continue;
+            }
+            // pax 记录：“长度 键=值\n”
+            for (int offset = 0; offset < data.size();) {
+                int space = data.indexOf(' ', offset);
+                int length = space < 0 ? 0 : data.mid(offset, space - offset).toInt();
+                if (length <= 0 || offset + length > data.size()) {
+                    break;
+                }
+                const QByteArray record = data.mid(space + 1, offset + length - space - 2);
+                int equals = record.indexOf('=');
+                const QByteArray key = record.left(equals);
+                const QByteArray value = record.mid(equals + 1);
+                if (key == "path") {
+                    longName = QString::fromUtf8(value);
+                } else if (key == "size") {
+                    paxSize = value.toLongLong();
+                } else if (key == "mtime") {
+                    paxTime = qint64(value.toDouble() * 1000);
+                }
+                offset += length;
+            }
+            continue;
+        }
+
+        const qint64 entrySize = paxSize >= 0 ? paxSize : size;
+        const qint64 entryPadded = (entrySize + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+        QString path = longName;
+        if (path.isEmpty()) {
+            path = tarString(header, 100);
+            // ustar 的前缀字段
+            if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0') {
+                path = tarString(header + 345, 155) + '/' + path;
+            }
+        }
+        const qint64 modifiedTime = paxTime >= 0 ? paxTime : tarNumber(header + 136, 12) * 1000;
+        longName.clear();
+        paxSize = -1;
+        paxTime = -1;
+
+        // 普通文件、连续文件和硬链接列为文件，目录列为目录；符号链接和设备文件与扫描磁盘时一样跳过
+        if (type == '0' || type == '\0' || type == '7' || type == '1') {
+            addEntry(path, path.endsWith('/'), type == '1' ? 0 : entrySize, type == '1' ? 0 : entryPadded,
+                     modifiedTime);
+        } else if (type == '5') {
+            addEntry(path, true, 0, 0, modifiedTime);
+        }
+
+        // 硬链接、目录等条目没有数据块，size 为 0
+        if (type != '1' && type != '2' && type != '5' && entryPadded > 0 && !source->skip(entryPadded)) {
+            error = "tar 文件被截断";
+            return false;
+        }
+    }
+
+    // 没有结束块就到达文件末尾：部分 tar 工具不写结束块，已读到的条目仍然有效
+    if (first) {
+        error = source->errorString().isEmpty() ? QString("不是 tar 文件") : source->errorString();
+        return false;
+    }
+    return true;
+}
+
+ArchiveCache &ArchiveCache::instance()
+{
+    static ArchiveCache cache;
+    return cache;
+}
+
+std::shared_ptr<const ArchiveIndex> ArchiveCache::get(const QString &fileName, qint64 size, qint64 modifiedTime,
+                                                      QString *errorString)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(fileName);
+    if (it != entries.end() && it->size == size && it->modifiedTime == modifiedTime) {
+        it->lastUse = ++useCounter;
+        return it->index;
+    }
+    
+    // 其他线程正在读取同一个压缩包时等待它的结果，不重复解压
+    std::shared_ptr<Pending> pending = loading.value(fileName);
+    if (pending && pending->size == size && pending->modifiedTime == modifiedTime) {
+        lock.unlock();
+        std::shared_ptr<const ArchiveIndex> index = pending->index.get();
+        if (!index && errorString) {
+            *errorString = pending->error;
+        }
+        return index;
+    }
+    
+    std::promise<std::shared_ptr<const ArchiveIndex>> promise;
+    pending = std::make_shared<Pending>();
+    pending->size = size;
+    pending->modifiedTime = modifiedTime;
+    pending->index = promise.get_future().share();
+    loading.insert(fileName, pending);
+    
+    // 读取大的 tar.gz 可能很慢，不持有锁，其他线程可以同时读取别的压缩包
+    lock.unlock();
+    std::shared_ptr<const ArchiveIndex> index = ArchiveIndex::read(fileName, &pending->error);
+    promise.set_value(index);
+    if (!index && errorString) {
+        *errorString = pending->error;
+    }
+    lock.lock();
+    
+    if (loading.value(fileName) == pending) {
+        loading.remove(fileName);
+    }
+    if (index) {
+        auto old = entries.find(fileName);
+        if (old != entries.end()) {
+            cachedBytes -= old->index->memoryUsage();
+        }
+        entries.insert(fileName, { size, modifiedTime, ++useCounter, index });
+        cachedBytes += index->memoryUsage();
+        trim();
+    }
+    return index;
+}
+
+void ArchiveCache::setMemoryBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    memoryBudget = bytes;
+    trim();
+}
+
+void ArchiveCache::trim()
+{
+    // 调用方持有锁
+    while (memoryBudget > 0 && cachedBytes > memoryBudget && entries.size() > 1) {
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->lastUse < oldest->lastUse) {
+                oldest = it;
+            }
+        }
+        cachedBytes -= oldest->index->memoryUsage();
+        entries.erase(oldest);
+    }
+}
+
+void ArchiveCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    cachedBytes = 0;
+}
+
+size_t ArchiveCache::memoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return cachedBytes;
+}
@@ -0,0 +1,97 @@
+#ifndef ARCHIVEINDEX_H
+#define ARCHIVEINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringRef>
+#include <QVector>
+#include <future>
+#include <memory>
+#include <mutex>
+
+// 压缩包的目录结构：只读取元数据，不解压任何文件内容。
+// zip 只读末尾的中央目录；tar 顺序读取各条目的头部，跳过数据块；
+// tar.gz 必须解压才能找到头部，解压出的数据直接丢弃（需要构建时找到 zlib）
+class ArchiveIndex
+{
+public:
+    struct Node {
+        QString name;
+        int parent = -1;
+        bool dir = false;
+        qint64 size = 0;            // 解压后的大小
+        qint64 compressedSize = 0;  // 在压缩包中占用的字节数（tar 为按 512 字节块对齐的大小，tar.gz 无法按条目区分）
+        qint64 modifiedTime = 0;    // 毫秒时间戳
+        QVector<int> children;
+    };
+
+    // 名称是否像支持的压缩包（按扩展名判断，不区分大小写）
+    static bool isArchiveName(const QStringRef &name);
+    static bool isArchiveName(const QString &name) { return isArchiveName(QStringRef(&name)); }
+
+    // 读取压缩包的目录结构，失败时返回 nullptr
+    static std::shared_ptr<const ArchiveIndex> read(const QString &fileName, QString *errorString = nullptr);
+
+    // 压缩包内的路径以 / 分隔，空字符串为压缩包的根。不存在时返回 -1
+    int find(const QString &innerPath) const;
+    const Node &node(int index) const { return nodes[index]; }
+    int size() const { return nodes.size(); }
+    size_t memoryUsage() const;
+
+private:
+    QVector<Node> nodes;
+    QHash<QString, int> directories;    // 目录的规范化路径，文件通过所在目录查找
+    qint64 archiveModifiedTime = 0;     // 压缩包中没有单独条目的上级目录使用压缩包的修改时间
+    QHash<QString, int> files;          // 读取期间文件的规范化路径，用于合并重复条目，读完即释放
+
+    int ensureDirectory(const QString &path);
+    void addEntry(QString path, bool dir, qint64 size, qint64 compressedSize, qint64 modifiedTime);
+    bool readZip(const QString &fileName, QString &error);
+    bool readTar(const QString &fileName, bool gzip, QString &error);
+};
+
+// 已读取的压缩包目录结构的进程级缓存，按路径、大小和修改时间识别。
+// 总内存超过上限时淘汰最久未使用的；多个线程同时请求同一个压缩包时只读取一次，其余线程等待结果
+class ArchiveCache
+{
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = size_t(256) << 20;
+
+    static ArchiveCache &instance();
+
+    // 压缩包未变化时直接返回缓存的结果，否则重新读取
+    std::shared_ptr<const ArchiveIndex> get(const QString &fileName, qint64 size, qint64 modifiedTime,
+                                            QString *errorString = nullptr);
+    // 缓存可以使用的内存（字节），0 表示不限。最近读取的一个总是保留
+    void setMemoryBudget(size_t bytes);
+    void clear();
+    size_t memoryUsage() const;
+
+private:
+    struct Entry {
+        qint64 size;
+        qint64 modifiedTime;
+        quint64 lastUse;
+        std::shared_ptr<const ArchiveIndex> index;
+    };
+
+    // 正在读取的压缩包，读取失败时 index 为空
+    struct Pending {
+        qint64 size;
+        qint64 modifiedTime;
+        std::shared_future<std::shared_ptr<const ArchiveIndex>> index;
+        QString error;          // 在 index 就绪前写入
+    };
+
+    ArchiveCache() = default;
+    void trim();
+
+    mutable std::mutex mutex;
+    QHash<QString, Entry> entries;
+    QHash<QString, std::shared_ptr<Pending>> loading;
+    quint64 useCounter = 0;
+    size_t memoryBudget = DEFAULT_MEMORY_BUDGET;
+    size_t cachedBytes = 0;
+};
+
+#endif // ARCHIVEINDEX_H
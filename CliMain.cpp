@@ -0,0 +1,477 @@
+// 无界面的命令行入口：不创建 QApplication，也不加载任何 GUI 插件，适合定时任务和 CI 使用。
+// 多个根目录（命令行参数或清单文件）可并行扫描，结果按给出的顺序依次流式写出
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThread>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "DirectoryTree.h"
+#include "ScanProfiler.h"
+
+namespace {
+
+enum class CliFormat {
+    TEXT,
+    MARKDOWN,
+    JSON,
+    NDJSON
+};
+
+struct CliOptions {
+    CliFormat format = CliFormat::TEXT;
+    int maxDepth = -1;
+    QString indentChars = "    ";
+    bool showFiles = true;
+    bool showHidden = false;
+    bool followSymlinks = false;
+    bool oneFileSystem = false;
+    bool browseArchives = false;
+    QStringList ignorePatterns;
+    SortType sortType = SortType::DIRS_FIRST;
+    SizeMode sizeMode = SizeMode::NONE;
+    int threadsPerRoot = 0;     // 0 表示按并行的根目录数平分 CPU 核心
+    qint64 memoryBudget = 0;    // 每个根目录可用的内存，0 表示不限
+    ScannerBackend backend = ScannerBackend::NATIVE;
+    bool useIoUring = true;
+    std::shared_ptr<const SyntheticFileSystem> synthetic;  // 非空时扫描描述文件中的内存目录树
+    SyntheticLatency latency;
+};
+
+// 扫描和渲染共用同一套选项，保证输出与界面中的结果一致
+void configure(DirectoryTree &tree, const CliOptions &options)
+{
+    tree.setMaxDepth(options.maxDepth);
+    tree.setIndentChars(options.indentChars);
+    tree.setShowFiles(options.showFiles);
+    tree.setShowHidden(options.showHidden);
+    tree.setFollowSymlinks(options.followSymlinks);
+    tree.setOneFileSystem(options.oneFileSystem);
+    tree.setBrowseArchives(options.browseArchives);
+    tree.setIgnorePatterns(options.ignorePatterns);
+    tree.setSortType(options.sortType);
+    tree.setSizeMode(options.sizeMode);
+    tree.setOutputFormat(options.format == CliFormat::MARKDOWN ? OutputFormat::MARKDOWN : OutputFormat::TEXT);
+    tree.setThreadCount(options.threadsPerRoot);
+    tree.setScannerBackend(options.backend);
+    tree.setUseIoUring(options.useIoUring);
+    tree.setSyntheticFileSystem(options.synthetic, options.latency);
+    tree.setMemoryBudget(options.memoryBudget);
+}
+
+bool parseSortType(const QString &value, SortType &type)
+{
+    static const struct {
+        const char *name;
+        SortType type;
+    } names[] = {
+        { "name", SortType::NAME },
+        { "natural", SortType::NATURAL },
+        { "mtime", SortType::MODIFIED_TIME },
+        { "size", SortType::SIZE },
+        { "count", SortType::ENTRY_COUNT },
+        { "files-first", SortType::FILES_FIRST },
+        { "dirs-first", SortType::DIRS_FIRST },
+    };
+    for (const auto &entry : names) {
+        if (value == QLatin1String(entry.name)) {
+            type = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseFormat(const QString &value, CliFormat &format)
+{
+    if (value == "text") {
+        format = CliFormat::TEXT;
+    } else if (value == "markdown" || value == "md") {
+        format = CliFormat::MARKDOWN;
+    } else if (value == "json") {
+        format = CliFormat::JSON;
+    } else if (value == "ndjson") {
+        format = CliFormat::NDJSON;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseSizeMode(const QString &value, SizeMode &mode)
+{
+    if (value == "none") {
+        mode = SizeMode::NONE;
+    } else if (value == "apparent") {
+        mode = SizeMode::APPARENT;
+    } else if (value == "allocated") {
+        mode = SizeMode::ALLOCATED;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// 逗号分隔的 列出,stat,抖动 延迟（微秒），后面的项可以省略
+bool parseLatency(const QString &value, SyntheticLatency &latency)
+{
+    const QStringList parts = value.split(',');
+    if (parts.size() > 3) {
+        return false;
+    }
+    qint64 *fields[] = { &latency.listMicros, &latency.statMicros, &latency.jitterMicros };
+    for (int i = 0; i < parts.size(); ++i) {
+        bool ok = false;
+        *fields[i] = parts.at(i).trimmed().toLongLong(&ok);
+        if (!ok || *fields[i] < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 清单文件每行一个根目录，空行和 # 开头的行忽略；"-" 表示从标准输入读取
+bool readManifest(const QString &path, QStringList &roots, QString &error)
+{
+    QFile file;
+    bool opened;
+    if (path == "-") {
+        opened = file.open(stdin, QIODevice::ReadOnly | QIODevice::Text);
+    } else {
+        file.setFileName(path);
+        opened = file.open(QIODevice::ReadOnly | QIODevice::Text);
+    }
+    if (!opened) {
+        error = file.errorString();
+        return false;
+    }
+
+    QTextStream in(&file);
+    in.setCodec("UTF-8");
+    QString line;
+    while (in.readLineInto(&line)) {
+        line = line.trimmed();
+        if (!line.isEmpty() && !line.startsWith('#')) {
+            roots.append(line);
+        }
+    }
+    return true;
+}
+
+// 多个根目录的扫描结果。工作线程按顺序领取根目录，主线程按同样的顺序等待并写出；
+// 已扫描但尚未写出的树最多领先 window 个，避免写出慢时内存中堆积大量的树
+class RootQueue
+{
+public:
+    RootQueue(const QStringList &roots, int window)
+        : roots(roots), trees(size_t(roots.size())), done(size_t(roots.size()), false), window(window)
+    {
+    }
+
+    // 领取下一个要扫描的根目录，全部领取完后返回 -1
+    int take()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]() { return next >= roots.size() || next < written + window; });
+        return next < roots.size() ? next++ : -1;
+    }
+
+    void finish(int index, std::shared_ptr<ScannedTree> tree)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            trees[size_t(index)] = std::move(tree);
+            done[size_t(index)] = true;
+        }
+        changed.notify_all();
+    }
+
+    // 等待第 index 个根目录扫描完毕并取走结果（失败时为空）
+    std::shared_ptr<ScannedTree> wait(int index)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this, index]() { return bool(done[size_t(index)]); });
+        return std::move(trees[size_t(index)]);
+    }
+
+    void markWritten(int index)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            written = index + 1;
+        }
+        changed.notify_all();
+    }
+
+    const QString &root(int index) const { return roots.at(index); }
+
+private:
+    const QStringList roots;
+    std::vector<std::shared_ptr<ScannedTree>> trees;
+    std::vector<bool> done;
+    const int window;
+    int next = 0;
+    int written = 0;
+    std::mutex mutex;
+    std::condition_variable changed;
+};
+
+bool writeTree(DirectoryTree &renderer, const ScannedTree &tree, CliFormat format, QIODevice *device,
+               QString &error)
+{
+    switch (format) {
+        case CliFormat::TEXT:
+        case CliFormat::MARKDOWN: {
+            QTextStream out(device);
+            out.setCodec("UTF-8");
+            renderer.renderTree(tree, out);
+            out.flush();
+            if (out.status() != QTextStream::Ok) {
+                error = device->errorString();
+                return false;
+            }
+            return true;
+        }
+        case CliFormat::JSON:
+            return renderer.writeJsonTree(tree, device, &error) && device->write("\n", 1) == 1;
+        case CliFormat::NDJSON:
+            return renderer.writeNdjsonTree(tree, device, &error);
+    }
+    return false;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("dtv");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("生成目录树（无界面版本）。多个根目录的结果按给出的顺序依次输出；"
+                                     "JSON 格式每个根目录输出一个文档，文档之间以换行分隔");
+    parser.addHelpOption();
+    parser.addPositionalArgument("roots", "要扫描的根目录", "[roots...]");
+
+    QCommandLineOption formatOption({ "f", "format" }, "输出格式：text、markdown、json 或 ndjson（默认 text）", "format", "text");
+    QCommandLineOption depthOption({ "d", "depth" }, "最大深度，-1 表示不限（默认 -1）", "depth", "-1");
+    QCommandLineOption ignoreOption({ "i", "ignore" }, "忽略匹配的文件或文件夹，支持通配符，可多次指定或以逗号分隔", "pattern");
+    QCommandLineOption sortOption({ "s", "sort" },
+                                  "排序方式：name、natural、mtime、size、count、files-first 或 dirs-first（默认 dirs-first）",
+                                  "sort", "dirs-first");
+    QCommandLineOption hiddenOption({ "a", "hidden" }, "显示隐藏文件");
+    QCommandLineOption noFilesOption("no-files", "只显示文件夹");
+    QCommandLineOption oneFileSystemOption({ "x", "one-file-system" }, "不进入其他文件系统的挂载点（与 find -xdev 相同）");
+    QCommandLineOption followOption({ "L", "follow-symlinks" }, "跟随符号链接；每个目录只读取一次，硬链接在大小汇总中只计一次");
+    QCommandLineOption archivesOption("archives", "把 zip、tar 和 tar.gz 文件当作目录列出其中的条目（不解压）");
+    QCommandLineOption indentOption("indent", "文本输出的缩进字符（默认四个空格）", "chars", "    ");
+    QCommandLineOption sizeOption("size", "文本输出中显示的大小：none、apparent 或 allocated（默认 none）", "mode", "none");
+    QCommandLineOption outputOption({ "o", "output" }, "写入文件而不是标准输出", "file");
+    QCommandLineOption manifestOption({ "m", "manifest" }, "从清单文件读取根目录，每行一个；- 表示标准输入", "file");
+    QCommandLineOption jobsOption({ "j", "jobs" }, "同时扫描的根目录数（默认 1）", "n", "1");
+    QCommandLineOption threadsOption({ "t", "threads" }, "每个根目录的扫描线程数（默认按 CPU 核心数平分）", "n", "0");
+    QCommandLineOption backendOption("backend", "扫描后端：native 或 qdir", "backend", "native");
+    QCommandLineOption noIoUringOption("no-io-uring", "不使用 io_uring 批量获取元数据");
+    QCommandLineOption syntheticOption("synthetic", "扫描描述文件给出的内存目录树而不是磁盘，根目录为树内的路径（/ 为树根）。"
+                                       "描述文件可用 find ROOT -printf '%y %s %P\\n' 生成", "file");
+    QCommandLineOption latencyOption("latency", "内存目录树每次调用注入的延迟（微秒）：列出,stat,抖动", "list,stat,jitter", "0");
+    QCommandLineOption memoryOption("max-memory", "内存上限（MB），0 表示不限（默认物理内存的一半）。"
+                                    "达到上限时不再读取新的目录，输出中它们只显示名称", "mb",
+                                    QString::number(DirectoryTree::defaultMemoryBudget() >> 20));
+    QCommandLineOption profileOption("profile", "记录各阶段耗时：摘要写到标准错误，Chrome/Perfetto 跟踪写入文件", "trace.json");
+    parser.addOptions({ formatOption, depthOption, ignoreOption, sortOption, hiddenOption, noFilesOption,
+                        followOption, oneFileSystemOption, archivesOption, indentOption, sizeOption, outputOption, manifestOption,
+                        jobsOption, threadsOption,
+                        backendOption, noIoUringOption, syntheticOption, latencyOption, memoryOption, profileOption });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    auto usageError = [&err](const QString &message) {
+        err << "dtv: " << message << '\n';
+        err.flush();
+        return 2;
+    };
+
+    CliOptions options;
+    bool ok = true;
+    if (!parseFormat(parser.value(formatOption), options.format)) {
+        return usageError("未知的输出格式：" + parser.value(formatOption));
+    }
+    options.maxDepth = parser.value(depthOption).toInt(&ok);
+    if (!ok) {
+        return usageError("无效的深度：" + parser.value(depthOption));
+    }
+    for (const QString &value : parser.values(ignoreOption)) {
+        for (const QString &pattern : value.split(',', QString::SkipEmptyParts)) {
+            options.ignorePatterns.append(pattern.trimmed());
+        }
+    }
+    if (!parseSortType(parser.value(sortOption), options.sortType)) {
+        return usageError("未知的排序方式：" + parser.value(sortOption));
+    }
+    if (!parseSizeMode(parser.value(sizeOption), options.sizeMode)) {
+        return usageError("未知的大小显示方式：" + parser.value(sizeOption));
+    }
+    options.showHidden = parser.isSet(hiddenOption);
+    options.showFiles = !parser.isSet(noFilesOption);
+    options.followSymlinks = parser.isSet(followOption);
+    options.oneFileSystem = parser.isSet(oneFileSystemOption);
+    options.browseArchives = parser.isSet(archivesOption);
+    options.indentChars = parser.value(indentOption);
+    options.backend = parser.value(backendOption) == "qdir" ? ScannerBackend::QDIR : ScannerBackend::NATIVE;
+    options.useIoUring = !parser.isSet(noIoUringOption);
+    if (parser.isSet(syntheticOption)) {
+        QString error;
+        options.synthetic = SyntheticFileSystem::load(parser.value(syntheticOption), &error);
+        if (!options.synthetic) {
+            return usageError("无法读取描述文件 " + parser.value(syntheticOption) + "：" + error);
+        }
+        options.backend = ScannerBackend::SYNTHETIC;
+    }
+    if (!parseLatency(parser.value(latencyOption), options.latency)) {
+        return usageError("无效的延迟：" + parser.value(latencyOption));
+    }
+
+    int jobs = parser.value(jobsOption).toInt(&ok);
+    if (!ok || jobs < 1) {
+        return usageError("无效的并行数：" + parser.value(jobsOption));
+    }
+    options.threadsPerRoot = parser.value(threadsOption).toInt(&ok);
+    if (!ok || options.threadsPerRoot < 0) {
+        return usageError("无效的线程数：" + parser.value(threadsOption));
+    }
+
+    qint64 memoryMb = parser.value(memoryOption).toLongLong(&ok);
+    if (!ok || memoryMb < 0) {
+        return usageError("无效的内存上限：" + parser.value(memoryOption));
+    }
+
+    QStringList roots = parser.positionalArguments();
+    if (parser.isSet(manifestOption)) {
+        QString error;
+        if (!readManifest(parser.value(manifestOption), roots, error)) {
+            return usageError("无法读取清单 " + parser.value(manifestOption) + "：" + error);
+        }
+    }
+    if (roots.isEmpty()) {
+        return usageError("没有指定根目录（使用 --help 查看用法）");
+    }
+
+    jobs = qMin(jobs, roots.size());
+    if (options.threadsPerRoot == 0) {
+        options.threadsPerRoot = qMax(1, QThread::idealThreadCount() / jobs);
+    }
+    // 同时在内存中的树最多为正在扫描的 jobs 棵加上等待写出的 2 * jobs 棵
+    options.memoryBudget = (memoryMb << 20) / (3 * jobs);
+
+    // 标准输出直接写出，不经过临时文件；写入文件时全部成功才替换目标文件
+    QFile standardOutput;
+    QSaveFile outputFile;
+    QIODevice *device = nullptr;
+    const bool toFile = parser.isSet(outputOption) && parser.value(outputOption) != "-";
+    if (toFile) {
+        outputFile.setFileName(parser.value(outputOption));
+        if (!outputFile.open(QIODevice::WriteOnly)) {
+            return usageError("无法写入 " + parser.value(outputOption) + "：" + outputFile.errorString());
+        }
+        device = &outputFile;
+    } else {
+        if (!standardOutput.open(stdout, QIODevice::WriteOnly, QFileDevice::DontCloseHandle)) {
+            return usageError("无法写入标准输出");
+        }
+        device = &standardOutput;
+    }
+
+    if (parser.isSet(profileOption)) {
+        ScanProfiler::instance().setEnabled(true);
+    }
+
+    RootQueue queue(roots, 2 * jobs);
+    std::vector<QThread *> workers;
+    for (int i = 0; i < jobs; ++i) {
+        QThread *worker = QThread::create([&queue, &options]() {
+            DirectoryTree scanner;
+            configure(scanner, options);
+            for (int index = queue.take(); index >= 0; index = queue.take()) {
+                const QString &root = queue.root(index);
+                std::shared_ptr<ScannedTree> tree;
+                DirEntry info;
+                if (scanner.statPath(root, info) && info.isDir()) {
+                    // 内存目录树中的路径不相对于当前目录
+                    tree = scanner.scan(options.synthetic ? root : QFileInfo(root).absoluteFilePath());
+                }
+                queue.finish(index, std::move(tree));
+            }
+        });
+        worker->start();
+        workers.push_back(worker);
+    }
+
+    DirectoryTree renderer;
+    configure(renderer, options);
+    int failures = 0;
+    bool writeFailed = false;
+    for (int index = 0; index < roots.size(); ++index) {
+        std::shared_ptr<ScannedTree> tree = queue.wait(index);
+        if (!tree) {
+            err << "dtv: 不是目录：" << queue.root(index) << '\n';
+            err.flush();
+            ++failures;
+        } else if (!writeFailed) {
+            if (tree->memoryLimited) {
+                err << "dtv: 已达到内存上限，" << queue.root(index) << " 中的部分目录只输出了汇总大小，没有列出其中的条目\n";
+                err.flush();
+            }
+            // 文本输出的多棵树之间空一行
+            if (index > 0 && (options.format == CliFormat::TEXT || options.format == CliFormat::MARKDOWN)) {
+                device->write("\n", 1);
+            }
+            QString error;
+            if (!writeTree(renderer, *tree, options.format, device, error)) {
+                err << "dtv: 写入失败：" << error << '\n';
+                err.flush();
+                writeFailed = true;
+            }
+            if (!toFile) {
+                standardOutput.flush();
+            }
+        }
+        // 写出后立即释放，给工作线程腾出位置
+        tree.reset();
+        queue.markWritten(index);
+    }
+
+    for (QThread *worker : workers) {
+        worker->wait();
+        delete worker;
+    }
+
+    if (parser.isSet(profileOption)) {
+        ScanProfiler &profiler = ScanProfiler::instance();
+        profiler.setEnabled(false);
+        err << profiler.summary();
+        err.flush();
+        QSaveFile traceFile(parser.value(profileOption));
+        QString error;
+        if (!traceFile.open(QIODevice::WriteOnly) || !profiler.writeChromeTrace(&traceFile, &error)
+                || !traceFile.commit()) {
+            err << "dtv: 无法写入 " << parser.value(profileOption) << "：" << (error.isEmpty() ? traceFile.errorString() : error) << '\n';
+            err.flush();
+        }
+    }
+
+    if (toFile) {
+        if (writeFailed) {
+            outputFile.cancelWriting();
+        } else if (!outputFile.commit()) {
+            return usageError("无法写入 " + parser.value(outputOption) + "：" + outputFile.errorString());
+        }
+    }
+    return (failures > 0 || writeFailed) ? 1 : 0;
+}
@@ -0,0 +1,49 @@
+#include "DevicePools.h"
+
+DevicePools::DevicePools(const MountTable &mounts, int localConcurrency)
+    : mounts(mounts), localConcurrency(qMax(1, localConcurrency)), submitted(0)
+{
+}
+
+WorkStealingPool *DevicePools::poolFor(quint64 device)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<WorkStealingPool> &pool = pools[device];
+    if (!pool) {
+        pool = std::make_shared<WorkStealingPool>(mounts.concurrencyFor(device, localConcurrency));
+    }
+    return pool.get();
+}
+
+void DevicePools::submit(quint64 device, WorkStealingPool::Task task)
+{
+    // 先计数再提交：waitForIdle 据此发现等待期间新派生的任务
+    submitted.fetch_add(1, std::memory_order_acq_rel);
+    poolFor(device)->submit(std::move(task));
+}
+
+void DevicePools::waitForIdle()
+{
+    // 任务只在执行中向其他线程池派生任务。某一轮依次等到每个线程池空闲、
+    // 期间没有提交过任何任务时，所有线程池都已空闲
+    while (true) {
+        qint64 before = submitted.load(std::memory_order_acquire);
+        QList<std::shared_ptr<WorkStealingPool>> current;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = pools.values();
+        }
+        for (const auto &pool : current) {
+            pool->waitForIdle();
+        }
+        if (submitted.load(std::memory_order_acquire) == before) {
+            return;
+        }
+    }
+}
+
+int DevicePools::poolCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pools.size();
+}
@@ -0,0 +1,38 @@
+#ifndef DEVICEPOOLS_H
+#define DEVICEPOOLS_H
+
+#include <QHash>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "MountTable.h"
+#include "WorkStealingPool.h"
+
+// 按设备划分的扫描线程池：每个设备（文件系统）有自己的工作窃取线程池，线程数按挂载表给出，
+// 慢的网络挂载只占用自己的线程，不会拖住本地磁盘上的扫描。线程池在第一次遇到该设备时创建
+class DevicePools
+{
+public:
+    DevicePools(const MountTable &mounts, int localConcurrency);
+
+    DevicePools(const DevicePools &) = delete;
+    DevicePools &operator=(const DevicePools &) = delete;
+
+    // 把读取 device 上某个目录的任务交给该设备的线程池
+    void submit(quint64 device, WorkStealingPool::Task task);
+    // 阻塞直到所有线程池都空闲（任务可以向其他设备的线程池派生任务）
+    void waitForIdle();
+    // 已创建的线程池数，即扫描经过的设备数
+    int poolCount() const;
+
+private:
+    WorkStealingPool *poolFor(quint64 device);
+
+    const MountTable &mounts;
+    int localConcurrency;
+    mutable std::mutex mutex;
+    QHash<quint64, std::shared_ptr<WorkStealingPool>> pools;
+    std::atomic<qint64> submitted;
+};
+
+#endif // DEVICEPOOLS_H
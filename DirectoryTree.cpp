@@ -1,15 +1,96 @@
 #include "DirectoryTree.h"
 #include <QFileInfo>
+#include <QHash>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QRegularExpression>
 #include <QDateTime>
+#include <QTextStream>
+#include <QThread>
+#include <QLocale>
+#include <algorithm>
+#include "ArchiveBackend.h"
+#include "DevicePools.h"
+#include "JsonTreeWriter.h"
+#include "ScanProfiler.h"
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 预先计算的排序键，按 (group, value, text) 依次比较，index 指回原来的条目，
+// 同时作为最后的比较项，使结果与输入顺序稳定一致
+struct SortKey {
+    int group = 0;
+    qint64 value = 0;   // 数值键（修改时间、大小等），从大到小时取负值
+    QString text;
+    int index = 0;
+    
+    bool operator<(const SortKey &other) const
+    {
+        if (group != other.group) {
+            return group < other.group;
+        }
+        if (value != other.value) {
+            return value < other.value;
+        }
+        int order = text.compare(other.text);
+        return order != 0 ? order < 0 : index < other.index;
+    }
+};
+
+QString nameKey(const QString &name)
+{
+    return name.toLower();
+}
+
+// 自然排序键：小写名称中每段连续数字替换为 '0'、去掉前导零后的位数、数字本身，
+// 逐字比较时数字段先按位数再按数值排序，与其他字符的相对顺序和普通数字字符相同
+QString naturalKey(const QString &name)
+{
+    const QString lower = name.toLower();
+    QString key;
+    key.reserve(lower.size() + 8);
+    
+    for (int i = 0; i < lower.size();) {
+        if (!lower.at(i).isDigit()) {
+            key += lower.at(i++);
+            continue;
+        }
+        
+        int start = i;
+        while (i < lower.size() && lower.at(i).isDigit()) {
+            ++i;
+        }
+        int first = start;
+        while (first < i - 1 && lower.at(first) == QLatin1Char('0')) {
+            ++first;
+        }
+        key += QLatin1Char('0');
+        key += QChar(ushort(qMin(i - first, 0xFFFF)));
+        key += lower.midRef(first, i - first);
+    }
+    return key;
+}
+
+}
 
 DirectoryTree::DirectoryTree()
     : maxDepth(-1), indentChars("    "), showFiles(true), showHidden(false),
-      sortType(SortType::DIRS_FIRST), outputFormat(OutputFormat::TEXT),
-      totalItems(0), processedItems(0)
+      sortType(SortType::DIRS_FIRST), sizeMode(SizeMode::NONE), outputFormat(OutputFormat::TEXT),
+      threadCount(QThread::idealThreadCount()),
+#ifdef Q_OS_LINUX
+      scannerBackend(ScannerBackend::NATIVE),
+#else
+      scannerBackend(ScannerBackend::QDIR),
+#endif
+      useIoUring(true), followSymlinks(false), oneFileSystem(false), browseArchives(false), memoryBudget(0),
+      scanDepthLimit(-1), trustedBefore(0), rootDevice(0), totalItems(0), processedItems(0),
+      dirsDiscovered(0), dirsCompleted(0), entriesSeen(0), bytesStatted(0), relistedDirectories(0),
+      treeMemory(0), memoryLimitReached(false), memoryBaseline(0), cancelRequested(false)
 {
+    resetDirectoryCounts();
 }
 
 void DirectoryTree::setMaxDepth(int depth)
@@ -35,12 +116,9 @@ void DirectoryTree::setShowHidden(bool show)
 void DirectoryTree::setIgnorePatterns(const QStringList &patterns)
 {
     ignorePatterns = patterns;
-    ignoredDirs.clear();
-    for (const QString &pattern : patterns) {
-        if (!pattern.contains('*') && !pattern.contains('?')) {
-            ignoredDirs.insert(pattern);
-        }
-    }
+    
+    // 模式只在这里编译一次，扫描时逐项匹配不再构造正则
+    ignoreMatcher.setPatterns(patterns);
 }
 
 void DirectoryTree::setSortType(SortType type)
@@ -48,12 +126,128 @@ void DirectoryTree::setSortType(SortType type)
     sortType = type;
 }
 
+void DirectoryTree::setSizeMode(SizeMode mode)
+{
+    sizeMode = mode;
+}
+
 void DirectoryTree::setOutputFormat(OutputFormat format)
 {
     outputFormat = format;
 }
 
-QString DirectoryTree::generateTree(const QString &rootPath)
+void DirectoryTree::setThreadCount(int count)
+{
+    threadCount = qMax(1, count);
+}
+
+void DirectoryTree::setScannerBackend(ScannerBackend type)
+{
+    scannerBackend = FileSystemBackend::isAvailable(type) ? type : ScannerBackend::QDIR;
+    backend.reset();
+}
+
+void DirectoryTree::setUseIoUring(bool enable)
+{
+    useIoUring = enable;
+    backend.reset();
+}
+
+void DirectoryTree::setSyntheticFileSystem(std::shared_ptr<const SyntheticFileSystem> fileSystem,
+                                           const SyntheticLatency &latency)
+{
+    syntheticFileSystem = std::move(fileSystem);
+    syntheticLatency = latency;
+    backend.reset();
+}
+
+void DirectoryTree::setFollowSymlinks(bool follow)
+{
+    followSymlinks = follow;
+    backend.reset();
+}
+
+void DirectoryTree::setOneFileSystem(bool enable)
+{
+    oneFileSystem = enable;
+}
+
+void DirectoryTree::setBrowseArchives(bool enable)
+{
+    browseArchives = enable;
+    backend.reset();
+}
+
+void DirectoryTree::setMemoryBudget(qint64 bytes)
+{
+    memoryBudget = qMax<qint64>(0, bytes);
+}
+
+qint64 DirectoryTree::defaultMemoryBudget()
+{
+#ifdef Q_OS_UNIX
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGE_SIZE);
+    if (pages > 0 && pageSize > 0) {
+        return qint64(pages) * pageSize / 2;
+    }
+#endif
+    return qint64(4) << 30;
+}
+
+void DirectoryTree::requestCancel()
+{
+    cancelRequested.store(true, std::memory_order_relaxed);
+}
+
+bool DirectoryTree::isCancelled() const
+{
+    return cancelRequested.load(std::memory_order_relaxed);
+}
+
+ScanProgress DirectoryTree::progress() const
+{
+    // 先读完成数再读发现数，保证快照中 dirsCompleted 不超过 dirsDiscovered
+    ScanProgress result;
+    result.dirsCompleted = dirsCompleted.load(std::memory_order_acquire);
+    result.completedByDepth.reserve(DEPTH_STATS);
+    for (const std::atomic<qint64> &count : dirsCompletedAtDepth) {
+        result.completedByDepth.push_back(count.load(std::memory_order_acquire));
+    }
+    result.dirsDiscovered = dirsDiscovered.load(std::memory_order_acquire);
+    result.discoveredByDepth.reserve(DEPTH_STATS);
+    for (const std::atomic<qint64> &count : dirsDiscoveredAtDepth) {
+        result.discoveredByDepth.push_back(count.load(std::memory_order_acquire));
+    }
+    result.entriesSeen = entriesSeen.load(std::memory_order_relaxed);
+    result.bytesStatted = bytesStatted.load(std::memory_order_relaxed);
+    result.memoryBytes = treeMemory.load(std::memory_order_relaxed);
+    return result;
+}
+
+void DirectoryTree::discoverDirectory(int depth)
+{
+    dirsDiscoveredAtDepth[size_t(qMin(depth, DEPTH_STATS - 1))].fetch_add(1, std::memory_order_relaxed);
+    dirsDiscovered.fetch_add(1, std::memory_order_release);
+}
+
+void DirectoryTree::completeDirectory(int depth)
+{
+    dirsCompletedAtDepth[size_t(qMin(depth, DEPTH_STATS - 1))].fetch_add(1, std::memory_order_relaxed);
+    dirsCompleted.fetch_add(1, std::memory_order_release);
+}
+
+void DirectoryTree::resetDirectoryCounts()
+{
+    dirsDiscovered = 0;
+    dirsCompleted = 0;
+    for (int i = 0; i < DEPTH_STATS; ++i) {
+        dirsDiscoveredAtDepth[size_t(i)] = 0;
+        dirsCompletedAtDepth[size_t(i)] = 0;
+    }
+}
+
+QString DirectoryTree::rootNameOf(const QString &rootPath) const
 {
     QFileInfo rootInfo(rootPath);
     QString rootName = rootInfo.fileName();
@@ -62,261 +256,995 @@ QString DirectoryTree::generateTree(const QString &rootPath)
         rootName = rootPath;
     }
     
-    totalItems = 0;
-    processedItems = 0;
+    return rootName;
+}
+
+QString DirectoryTree::scanKey(const QString &rootPath) const
+{
+    return QStringList {
+        rootPath,
+        QString::number(maxDepth),
+        QString::number(showFiles),
+        QString::number(showHidden),
+        QString::number(followSymlinks),
+        QString::number(oneFileSystem),
+        QString::number(browseArchives),
+        QString::number(static_cast<int>(sortType)),
+        QString::number(static_cast<int>(sizeMode)),
+        ignorePatterns.join(QChar('/'))
+    }.join(QChar('|'));
+}
+
+QString DirectoryTree::sourceKey(const QString &rootPath) const
+{
+    return QStringList {
+        rootPath,
+        QString::number(maxDepth),
+        QString::number(showHidden),
+        QString::number(followSymlinks),
+        QString::number(oneFileSystem),
+        QString::number(browseArchives),
+        ignorePatterns.join(QChar('/'))
+    }.join(QChar('|'));
+}
+
+void DirectoryTree::initSource(ScannedTree &tree, const QString &rootPath) const
+{
+    tree.rootPath = rootPath;
+    tree.scanKey = sourceKey(rootPath);
+    tree.depthLimit = maxDepth;
+    tree.hiddenPruned = !showHidden;
+    tree.followedSymlinks = followSymlinks;
+    tree.oneFileSystem = oneFileSystem;
+    tree.browsedArchives = browseArchives;
+    tree.prunedPatterns = ignorePatterns;
+}
+
+bool DirectoryTree::covers(const ScannedTree &source) const
+{
+    // 更深的深度限制、显示隐藏项或去掉忽略模式都需要进入扫描时跳过的目录
+    if (source.depthLimit > 0 && (maxDepth <= 0 || maxDepth > source.depthLimit)) {
+        return false;
+    }
+    if (source.hiddenPruned && showHidden) {
+        return false;
+    }
+    // 跟随符号链接、文件系统边界和浏览压缩包改变的是扫描经过哪些目录，投影无法补上或去掉
+    if (source.followedSymlinks != followSymlinks || source.oneFileSystem != oneFileSystem
+            || source.browsedArchives != browseArchives) {
+        return false;
+    }
+    for (const QString &pattern : source.prunedPatterns) {
+        if (!ignorePatterns.contains(pattern)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DirectoryTree::ensureBackend()
+{
+    if (!backend) {
+        if (scannerBackend == ScannerBackend::SYNTHETIC && syntheticFileSystem) {
+            backend = std::make_unique<SyntheticBackend>(syntheticFileSystem, syntheticLatency, followSymlinks);
+        } else {
+            backend = FileSystemBackend::create(scannerBackend, useIoUring, followSymlinks);
+        }
+        if (browseArchives) {
+            backend = std::make_unique<ArchiveBackend>(std::move(backend));
+        }
+    }
+}
+
+std::shared_ptr<ScannedTree> DirectoryTree::scan(const QString &rootPath, bool shallow)
+{
+    return project(*scanSource(rootPath, shallow));
+}
+
+std::shared_ptr<ScannedTree> DirectoryTree::scanSource(const QString &rootPath, bool shallow)
+{
+    auto tree = std::make_shared<ScannedTree>();
+    initSource(*tree, rootPath);
+    tree->root = tree->nodes.createRoot(rootNameOf(rootPath));
+    
+    scanDepthLimit = shallow ? 1 : maxDepth;
+    runScan(*tree, nullptr);
+    tree->nodes.aggregateSizes();
+    
+    tree->complete = (!shallow || (maxDepth > 0 && maxDepth <= 1)) && !tree->memoryLimited;
+    return tree;
+}
+
+std::shared_ptr<ScannedTree> DirectoryTree::revalidate(const ScannedTree &cached)
+{
+    auto tree = std::make_shared<ScannedTree>();
+    initSource(*tree, cached.rootPath);
+    tree->root = tree->nodes.createRoot(cached.nodes.name(cached.root));
+    tree->nodes.reserve(cached.nodes.size());
     
-    // 预先计算总项目数
-    QDir dir(rootPath);
-    QDir::Filters filters = QDir::NoDotAndDotDot | QDir::AllEntries | QDir::NoSymLinks;
-    if (showHidden) {
-        filters |= QDir::Hidden;
+    // 修改时间与上次扫描开始时刻过于接近的目录可能在同一毫秒内又被修改过，不能信任
+    trustedBefore = cached.scanStartedAt - RACY_MODIFICATION_WINDOW_MS;
+    relistedDirectories = 0;
+    scanDepthLimit = maxDepth;
+    runScan(*tree, &cached);
+    tree->nodes.aggregateSizes();
+    
+    tree->complete = cached.complete && !tree->memoryLimited;
+    return tree;
+}
+
+void DirectoryTree::runScan(ScannedTree &tree, const ScannedTree *cached)
+{
+    tree.scanStartedAt = QDateTime::currentMSecsSinceEpoch();
+    ProfileScope scanScope(ProfilePhase::SCAN);
+    
+    resetDirectoryCounts();
+    discoverDirectory(0);
+    entriesSeen = 0;
+    bytesStatted = 0;
+    memoryBaseline = cached ? qint64(cached->nodes.memoryUsage()) : 0;
+    treeMemory = memoryBaseline;
+    memoryLimitReached = false;
+    visitedDirectories.clear();
+    seenFiles.clear();
+    linkedFiles.clear();
+    ensureBackend();
+    backend->beginScan();
+    
+    FileId rootId;
+    qint64 rootModifiedTime = 0;
+    backend->directoryModifiedTime(tree.rootPath, rootModifiedTime, &rootId);
+    rootDevice = rootId.device;
+    
+    NodeId cachedRoot = cached ? cached->root : INVALID_NODE;
+    // 跟随符号链接时，经多条路径到达的目录由最先到达的位置读取，哪个位置先到取决于线程调度，
+    // 读取的位置不同会使树的形状不同；这时改为单线程扫描，结果总是先序遍历中最先出现的位置
+    if (threadCount > 1 && !followSymlinks) {
+        // 每个子目录是一个任务，由所在设备的工作窃取线程池调度，各设备的并发数按挂载表决定；
+        // 各目录的子节点在列出时即已排序，硬链接计入的位置在扫描结束后按单线程的顺序重新选出，
+        // 因此结果与单线程扫描完全一致
+        MountTable mounts = MountTable::current();
+        DevicePools pools(mounts, threadCount);
+        ScannedTree *scanned = &tree;
+        pools.submit(rootDevice, [this, scanned, cached, cachedRoot, &pools]() {
+            scanDirectory(*scanned, scanned->root, scanned->rootPath, 0, &pools, cached, cachedRoot);
+        });
+        pools.waitForIdle();
+        resolveLinkedFiles(tree);
+    } else {
+        scanDirectory(tree, tree.root, tree.rootPath, 0, nullptr, cached, cachedRoot);
     }
-    dir.setFilter(filters);
-    dir.setSorting(QDir::DirsFirst | QDir::Name);
-    totalItems = dir.count();
     
-    // 根据输出格式选择相应的处理函数
-    switch (outputFormat) {
-        case OutputFormat::MARKDOWN:
-            return rootName + "\n" + processDirectoryMarkdown(rootPath, 0);
-        case OutputFormat::TEXT:
-        default:
-            return rootName + "\n" + processDirectory(rootPath, 0);
+    backend->endScan();
+    tree.scannedItems = entriesSeen;
+    tree.memoryLimited = memoryLimitReached;
+    scanScope.setItems(tree.scannedItems);
+}
+
+bool DirectoryTree::canPopulate(const ScannedTree &tree, NodeId node) const
+{
+    const NodeStore &nodes = tree.nodes;
+    if (!nodes.isDir(node) || nodes.isPopulated(node)) {
+        return false;
     }
+    
+    // 超出深度限制的目录在文本输出中也不会展开
+    return maxDepth <= 0 || nodes.depth(node) < maxDepth;
 }
 
-QJsonObject DirectoryTree::generateJsonTree(const QString &rootPath)
+QVector<DirEntry> DirectoryTree::listChildren(const QString &path)
 {
-    QFileInfo rootInfo(rootPath);
-    QString rootName = rootInfo.fileName();
+    ensureBackend();
     
-    if (rootName.isEmpty()) {
-        rootName = rootPath;
+    QVector<DirEntry> entries;
+    readDirectory(path, entries);
+    return entries;
+}
+
+QVector<DirEntry> DirectoryTree::relistChildren(const ScannedTree &tree, NodeId dir)
+{
+    QVector<DirEntry> entries = listChildren(tree.path(dir));
+    if (sortType != SortType::MODIFIED_TIME && sortType != SortType::SIZE && sortType != SortType::ENTRY_COUNT) {
+        return entries;
     }
     
-    totalItems = 0;
-    processedItems = 0;
+    // 这几种排序在 project 中按节点上的值对名称顺序做稳定排序；刚列出的子目录还没有汇总值，
+    // 取原来同名子目录的值（replaceChildren 会沿用它的子树），新出现的目录为 0
+    const NodeStore &nodes = tree.nodes;
+    QHash<QString, NodeId> oldDirs;
+    for (int i = 0; i < nodes.childCount(dir); ++i) {
+        NodeId child = nodes.child(dir, i);
+        if (nodes.isDir(child)) {
+            oldDirs.insert(nodes.name(child), child);
+        }
+    }
     
-    // 预先计算总项目数
-    QDir dir(rootPath);
-    QDir::Filters filters = QDir::NoDotAndDotDot | QDir::AllEntries | QDir::NoSymLinks;
-    if (showHidden) {
-        filters |= QDir::Hidden;
+    sortEntries(entries, SortType::NAME);
+    std::vector<qint64> keys;
+    keys.reserve(size_t(entries.size()));
+    for (DirEntry &entry : entries) {
+        NodeId old = entry.isDir() ? oldDirs.value(entry.name, INVALID_NODE) : INVALID_NODE;
+        if (old != INVALID_NODE) {
+            entry.modifiedTime = nodes.modifiedTime(old);
+            if (!entry.archive) {
+                entry.size = nodes.apparentSize(old);
+                entry.allocatedSize = nodes.allocatedSize(old);
+            }
+        } else if (entry.isDir() && !entry.archive) {
+            entry.size = 0;
+            entry.allocatedSize = 0;
+        }
+        
+        if (sortType == SortType::MODIFIED_TIME) {
+            keys.push_back(entry.modifiedTime);
+        } else if (sortType == SortType::SIZE) {
+            keys.push_back(sizeMode == SizeMode::ALLOCATED ? entry.allocatedSize : entry.size);
+        } else {
+            keys.push_back(old != INVALID_NODE ? qint64(nodes.descendantCount(old)) : 0);
+        }
     }
-    dir.setFilter(filters);
-    dir.setSorting(QDir::DirsFirst | QDir::Name);
-    totalItems = dir.count();
     
-    QJsonObject root;
-    root["name"] = rootName;
-    root["path"] = rootPath;
-    root["type"] = "directory";
-    root["children"] = processDirectoryJson(rootPath, 0);
+    std::vector<int> order(size_t(entries.size()));
+    for (int i = 0; i < entries.size(); ++i) {
+        order[size_t(i)] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&keys](int a, int b) {
+        return keys[size_t(a)] > keys[size_t(b)];
+    });
     
-    return root;
+    QVector<DirEntry> sorted;
+    sorted.reserve(entries.size());
+    for (int i : order) {
+        sorted.append(std::move(entries[i]));
+    }
+    return sorted;
 }
 
-bool DirectoryTree::shouldIgnore(const QString &name) const
+bool DirectoryTree::statPath(const QString &path, DirEntry &entry)
 {
-    if (ignoredDirs.contains(name)) {
-        return true;
+    ensureBackend();
+    return backend->statEntry(path, entry);
+}
+
+void DirectoryTree::scanDirectory(ScannedTree &tree, NodeId node, const QString &path, int depth, DevicePools *pools,
+                                  const ScannedTree *cached, NodeId cachedNode)
+{
+    // 扫描被取消时尽快返回
+    if (isCancelled()) {
+        return;
+    }
+    
+    // 检查深度限制
+    if (scanDepthLimit > 0 && depth >= scanDepthLimit) {
+        return;
     }
     
-    for (const QString &pattern : ignorePatterns) {
-        QRegularExpression regex(QRegularExpression::wildcardToRegularExpression(pattern));
-        if (regex.match(name).hasMatch()) {
-            return true;
+    // 读取本目录的耗时（不含子目录），用于找出慢的目录和挂载点
+    qint64 directoryStart = ScanProfiler::startTime();
+    
+    // 先取目录的修改时间再读取内容，读取期间发生的修改会在下次比较时被发现
+    qint64 modifiedTime = 0;
+    FileId id;
+    bool hasModifiedTime = backend->directoryModifiedTime(path, modifiedTime, &id);
+    
+    // 只扫描一个文件系统时，其他设备的挂载点留作未读取的节点（/proc、网络共享、快照等）
+    if (oneFileSystem && depth > 0 && id.isValid() && id.device != rootDevice) {
+        {
+            std::lock_guard<std::mutex> lock(storeMutex);
+            tree.nodes.markExcluded(node);
+        }
+        completeDirectory(depth);
+        return;
+    }
+    
+    // 跟随符号链接时同一目录可能经多条路径到达，链接也可能指回祖先目录形成环：
+    // 只有最先到达的位置读取它，其余位置留作未读取的节点
+    if (followSymlinks && id.isValid() && !visitedDirectories.insert(id)) {
+        {
+            std::lock_guard<std::mutex> lock(storeMutex);
+            tree.nodes.markExcluded(node);
+        }
+        completeDirectory(depth);
+        return;
+    }
+    
+    // 达到内存上限后不再把新的目录加入树中（根目录总是读取）：只统计其下的大小和条目数，
+    // 作为没有子节点的汇总目录留在树中，上级的汇总仍然完整；层级视图展开时再读取其中的条目
+    if (depth > 0 && memoryBudget > 0 && treeMemory.load(std::memory_order_relaxed) >= memoryBudget / 2) {
+        memoryLimitReached.store(true, std::memory_order_relaxed);
+        summarizeDirectory(tree, node, path);
+        completeDirectory(depth);
+        return;
+    }
+    
+    // 重新验证缓存的树时，修改时间没有变化的目录直接沿用缓存中的子项
+    const NodeStore *cachedNodes = cached && cachedNode != INVALID_NODE ? &cached->nodes : nullptr;
+    bool reuse = cachedNodes && cachedNodes->isPopulated(cachedNode) && hasModifiedTime
+            && modifiedTime == cachedNodes->modifiedTime(cachedNode) && modifiedTime < trustedBefore;
+    
+    QVector<DirEntry> entries;
+    if (reuse) {
+        copyChildren(*cachedNodes, cachedNode, entries);
+        // 文件内容或属性变化不会改变所在目录的修改时间：显示或排序用到元数据时逐个重新 stat 沿用的文件，
+        // 仍省去列目录；有文件变化时这个目录也算作重新读取，使快照被写回
+        if (needsMetadata() && restatFiles(path, entries)) {
+            relistedDirectories.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        if (cachedNodes) {
+            relistedDirectories.fetch_add(1, std::memory_order_relaxed);
+        }
+        
+        // 无法读取的目录也标记为已读取，之后按需展开时不再重试
+        if (!readSourceDirectory(path, entries)) {
+            {
+                std::lock_guard<std::mutex> lock(storeMutex);
+                tree.nodes.appendChildren(node, QVector<DirEntry>());
+            }
+            completeDirectory(depth);
+            if (directoryStart >= 0) {
+                ScanProfiler::instance().recordDirectory(path, directoryStart, 0);
+            }
+            return;
+        }
+    }
+    
+    // 同一目录的子节点一次性连续追加，每个目录只需加一次锁
+    NodeId firstChild;
+    {
+        ProfileScope buildScope(ProfilePhase::BUILD, entries.size());
+        std::lock_guard<std::mutex> lock(storeMutex);
+        firstChild = tree.nodes.appendChildren(node, entries);
+        tree.nodes.setModifiedTime(node, hasModifiedTime ? modifiedTime : 0);
+        // 隐藏或被忽略的目录不会读取，与其他有意跳过的目录一样不计入汇总
+        for (int i = 0; i < entries.size(); ++i) {
+            if (entries.at(i).isDir() && isPruned(entries.at(i))) {
+                tree.nodes.markExcluded(firstChild + NodeId(i));
+            }
+        }
+        if (pools) {
+            for (int i = 0; i < entries.size(); ++i) {
+                if (countsOnce(entries.at(i))) {
+                    linkedFiles.emplace_back(entries.at(i).id, firstChild + NodeId(i));
+                }
+            }
+        }
+        treeMemory.store(memoryBaseline + qint64(tree.nodes.memoryUsage()), std::memory_order_relaxed);
+    }
+    completeDirectory(depth);
+    if (directoryStart >= 0) {
+        ScanProfiler::instance().recordDirectory(path, directoryStart, entries.size());
+    }
+    
+    // 超出深度限制的子目录不会被读取，也不计入待扫描的目录
+    bool descend = scanDepthLimit <= 0 || depth + 1 < scanDepthLimit;
+    if (!descend) {
+        return;
+    }
+    
+    // 目录内容有变化时按名称找回仍然存在的子目录，继续复用它们的缓存
+    QHash<QString, NodeId> cachedSubdirs;
+    if (cachedNodes && !reuse && cachedNodes->isPopulated(cachedNode)) {
+        for (int i = 0; i < cachedNodes->childCount(cachedNode); ++i) {
+            NodeId cachedChild = cachedNodes->child(cachedNode, i);
+            if (cachedNodes->isDir(cachedChild)) {
+                cachedSubdirs.insert(cachedNodes->name(cachedChild), cachedChild);
+            }
         }
     }
     
-    return false;
+    for (int i = 0; i < entries.size(); ++i) {
+        const DirEntry &entry = entries.at(i);
+        if (!entry.isDir() || isPruned(entry)) {
+            continue;
+        }
+        
+        NodeId cachedChild = INVALID_NODE;
+        if (reuse) {
+            cachedChild = cachedNodes->child(cachedNode, i);
+        } else if (!cachedSubdirs.isEmpty()) {
+            cachedChild = cachedSubdirs.value(entry.name, INVALID_NODE);
+        }
+        
+        discoverDirectory(depth + 1);
+        NodeId child = firstChild + NodeId(i);
+        QString childPath = path.endsWith('/') ? path + entry.name : path + '/' + entry.name;
+        if (pools) {
+            // 原生后端列出的条目带有设备号，挂载点下的目录交给它所在设备的线程池
+            quint64 device = entry.id.isValid() ? entry.id.device : id.device;
+            ScannedTree *scanned = &tree;
+            pools->submit(device, [this, scanned, child, childPath, depth, pools, cached, cachedChild]() {
+                scanDirectory(*scanned, child, childPath, depth + 1, pools, cached, cachedChild);
+            });
+        } else {
+            scanDirectory(tree, child, childPath, depth + 1, nullptr, cached, cachedChild);
+        }
+    }
+}
+
+void DirectoryTree::summarizeDirectory(ScannedTree &tree, NodeId node, const QString &path)
+{
+    // 压缩包的大小是文件本身的，没有需要统计的内容
+    {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        if (tree.nodes.isArchive(node)) {
+            return;
+        }
+    }
+    
+    // 与完整扫描时的汇总规则相同：跳过的目录和重复的文件都不计入。跟随符号链接时（单线程）与树中的条目共用
+    // 已计入的文件；并行扫描时硬链接只在这个目录内去重。其中的压缩包只计文件本身
+    FileIdSet localFiles;
+    FileIdSet &countedFiles = followSymlinks ? seenFiles : localFiles;
+    qint64 size = 0;
+    qint64 allocated = 0;
+    quint32 count = 0;
+    std::vector<QString> pending(1, path);
+    QVector<DirEntry> entries;
+    while (!pending.empty()) {
+        if (isCancelled()) {
+            return;
+        }
+        
+        const QString dir = std::move(pending.back());
+        pending.pop_back();
+        entries.clear();
+        if (!backend->listDirectory(dir, true, true, entries)) {
+            continue;
+        }
+        entriesSeen.fetch_add(entries.size(), std::memory_order_relaxed);
+        
+        for (const DirEntry &entry : entries) {
+            if (entry.isDir() && !entry.archive) {
+                if (isPruned(entry) || (oneFileSystem && entry.id.isValid() && entry.id.device != rootDevice)
+                        || (followSymlinks && entry.id.isValid() && !visitedDirectories.insert(entry.id))) {
+                    continue;
+                }
+                ++count;
+                pending.push_back(dir.endsWith('/') ? dir + entry.name : dir + '/' + entry.name);
+                continue;
+            }
+            if (countsOnce(entry) && !countedFiles.insert(entry.id)) {
+                continue;
+            }
+            ++count;
+            size += entry.size;
+            allocated += entry.allocatedSize;
+        }
+    }
+    bytesStatted.fetch_add(size, std::memory_order_relaxed);
+    
+    std::lock_guard<std::mutex> lock(storeMutex);
+    tree.nodes.setSummary(node, size, allocated, count);
+}
+
+void DirectoryTree::copyChildren(const NodeStore &nodes, NodeId node, QVector<DirEntry> &entries)
+{
+    int count = nodes.childCount(node);
+    entries.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        NodeId child = nodes.child(node, i);
+        DirEntry entry;
+        entry.name = nodes.name(child);
+        entry.type = nodes.isDir(child) ? EntryType::DIRECTORY : EntryType::FILE;
+        entry.hidden = nodes.isHidden(child);
+        // 沿用的条目没有 inode，保留上次扫描时的判断
+        entry.symlink = nodes.isSymlink(child);
+        entry.duplicate = nodes.isDuplicate(child);
+        entry.archive = nodes.isArchive(child);
+        entry.modifiedTime = nodes.modifiedTime(child);
+        entry.size = nodes.apparentSize(child);
+        entry.allocatedSize = nodes.allocatedSize(child);
+        entry.hasMetadata = true;
+        entries.append(entry);
+    }
+    entriesSeen.fetch_add(count, std::memory_order_relaxed);
+}
+
+bool DirectoryTree::restatFiles(const QString &path, QVector<DirEntry> &entries)
+{
+    ProfileScope statScope(ProfilePhase::STAT, entries.size());
+    bool changed = false;
+    for (DirEntry &entry : entries) {
+        if (entry.isDir() && !entry.archive) {
+            continue;
+        }
+        
+        DirEntry current;
+        QString entryPath = path.endsWith('/') ? path + entry.name : path + '/' + entry.name;
+        if (!backend->statEntry(entryPath, current) || current.isDir() != entry.isDir()) {
+            continue;
+        }
+        if (current.size != entry.size || current.allocatedSize != entry.allocatedSize
+                || current.modifiedTime != entry.modifiedTime) {
+            entry.size = current.size;
+            entry.allocatedSize = current.allocatedSize;
+            entry.modifiedTime = current.modifiedTime;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool DirectoryTree::readSourceDirectory(const QString &path, QVector<DirEntry> &entries)
+{
+    // 超集树保留全部条目和修改时间，统一按名称排序，其余选项在投影时应用
+    if (!backend->listDirectory(path, true, true, entries)) {
+        return false;
+    }
+    {
+        ProfileScope sortScope(ProfilePhase::SORT, entries.size());
+        sortEntries(entries, SortType::NAME);
+    }
+    
+    // 硬链接（跟随符号链接时还有链接指向的文件）可能在树中多处出现，只有第一次出现时计入汇总
+    qint64 bytes = 0;
+    for (DirEntry &entry : entries) {
+        if (countsOnce(entry)) {
+            entry.duplicate = !seenFiles.insert(entry.id);
+        }
+        if (!entry.duplicate) {
+            bytes += entry.size;
+        }
+    }
+    entriesSeen.fetch_add(entries.size(), std::memory_order_relaxed);
+    bytesStatted.fetch_add(bytes, std::memory_order_relaxed);
+    return true;
+}
+
+bool DirectoryTree::countsOnce(const DirEntry &entry) const
+{
+    return (!entry.isDir() || entry.archive) && entry.id.isValid() && (followSymlinks || entry.linkCount > 1);
 }
 
-QFileInfoList DirectoryTree::getSortedEntries(const QDir &dir) const
+void DirectoryTree::resolveLinkedFiles(ScannedTree &tree)
 {
-    QFileInfoList list = dir.entryInfoList();
+    if (linkedFiles.empty()) {
+        return;
+    }
     
+    // 单线程扫描按目录的先序读取，同一目录内按行号（名称顺序）标记，先标记的一处计入汇总
+    NodeStore &nodes = tree.nodes;
+    std::vector<quint32> readOrder(size_t(nodes.size()), 0);
+    quint32 next = 0;
+    std::vector<NodeId> stack(1, tree.root);
+    while (!stack.empty()) {
+        NodeId dir = stack.back();
+        stack.pop_back();
+        readOrder[dir] = next++;
+        for (int i = nodes.childCount(dir) - 1; i >= 0; --i) {
+            NodeId child = nodes.child(dir, i);
+            if (nodes.isDir(child) && nodes.childCount(child) > 0) {
+                stack.push_back(child);
+            }
+        }
+    }
+    
+    // 同一目录的子节点编号连续且按行排列，目录的读取顺序相同时比较编号即可
+    std::sort(linkedFiles.begin(), linkedFiles.end(),
+              [&nodes, &readOrder](const std::pair<FileId, NodeId> &a, const std::pair<FileId, NodeId> &b) {
+        if (a.first.device != b.first.device) {
+            return a.first.device < b.first.device;
+        }
+        if (a.first.inode != b.first.inode) {
+            return a.first.inode < b.first.inode;
+        }
+        quint32 orderA = readOrder[nodes.parent(a.second)];
+        quint32 orderB = readOrder[nodes.parent(b.second)];
+        return orderA != orderB ? orderA < orderB : a.second < b.second;
+    });
+    for (size_t i = 0; i < linkedFiles.size(); ++i) {
+        bool first = i == 0 || !(linkedFiles[i].first == linkedFiles[i - 1].first);
+        nodes.setDuplicate(linkedFiles[i].second, !first);
+    }
+    linkedFiles.clear();
+}
+
+// 扫描超集树时不进入的目录：它们在当前选项下不显示，本身仍作为未读取的节点保留
+bool DirectoryTree::isPruned(const DirEntry &entry) const
+{
+    return (!showHidden && entry.hidden) || shouldIgnore(entry.name);
+}
+
+std::shared_ptr<ScannedTree> DirectoryTree::project(const ScannedTree &source) const
+{
+    ProfileScope projectScope(ProfilePhase::PROJECT, source.nodes.size());
+    auto tree = std::make_shared<ScannedTree>();
+    tree->rootPath = source.rootPath;
+    tree->scanKey = scanKey(source.rootPath);
+    tree->scannedItems = source.scannedItems;
+    tree->scanStartedAt = source.scanStartedAt;
+    tree->complete = source.complete;
+    tree->memoryLimited = source.memoryLimited;
+    
+    const NodeStore &from = source.nodes;
+    NodeStore &nodes = tree->nodes;
+    nodes.reserve(from.size());
+    tree->root = nodes.createRoot(from.name(source.root));
+    
+    // 按目录逐层复制，同一目录的子节点仍然连续
+    struct Pending {
+        NodeId from;
+        NodeId to;
+        int depth;
+    };
+    std::vector<Pending> queue;
+    queue.push_back({source.root, tree->root, 0});
+    std::vector<NodeId> kept;
+    
+    for (size_t next = 0; next < queue.size(); ++next) {
+        const Pending dir = queue[next];
+        // 超集树中未读取的目录在结果中同样未读取，可由层级视图按需展开
+        if (!from.isPopulated(dir.from) || (maxDepth > 0 && dir.depth >= maxDepth)) {
+            continue;
+        }
+        
+        kept.clear();
+        {
+            ProfileScope filterScope(ProfilePhase::FILTER, from.childCount(dir.from));
+            for (int i = 0; i < from.childCount(dir.from); ++i) {
+                NodeId child = from.child(dir.from, i);
+                if ((!showHidden && from.isHidden(child)) || (!showFiles && !from.isDir(child))) {
+                    continue;
+                }
+                if (shouldIgnore(from.name(child))) {
+                    continue;
+                }
+                kept.push_back(child);
+            }
+        }
+        {
+            ProfileScope sortScope(ProfilePhase::SORT, qint64(kept.size()));
+            orderChildren(from, kept);
+        }
+        
+        NodeId first;
+        {
+            ProfileScope buildScope(ProfilePhase::BUILD, qint64(kept.size()));
+            first = nodes.appendChildren(dir.to, from, kept.data(), int(kept.size()));
+        }
+        for (int i = 0; i < int(kept.size()); ++i) {
+            if (from.isDir(kept[size_t(i)])) {
+                queue.push_back({kept[size_t(i)], first + NodeId(i), dir.depth + 1});
+            }
+        }
+    }
+    
+    return tree;
+}
+
+// children 已按名称排好，按目录/文件分组只需稳定划分，按修改时间排序只比较保存的整数
+void DirectoryTree::orderChildren(const NodeStore &nodes, std::vector<NodeId> &children) const
+{
     switch (sortType) {
         case SortType::NAME:
-            std::sort(list.begin(), list.end(), [](const QFileInfo &a, const QFileInfo &b) {
-                return a.fileName().toLower() < b.fileName().toLower();
-            });
             break;
             
+        case SortType::NATURAL: {
+            // 只为这一组兄弟节点计算一次自然排序键
+            std::vector<SortKey> keys;
+            keys.reserve(children.size());
+            for (size_t i = 0; i < children.size(); ++i) {
+                SortKey key;
+                key.text = naturalKey(nodes.name(children[i]));
+                key.index = int(i);
+                keys.push_back(std::move(key));
+            }
+            std::sort(keys.begin(), keys.end());
+            
+            std::vector<NodeId> sorted;
+            sorted.reserve(children.size());
+            for (const SortKey &key : keys) {
+                sorted.push_back(children[size_t(key.index)]);
+            }
+            children.swap(sorted);
+            break;
+        }
+            
         case SortType::MODIFIED_TIME:
-            std::sort(list.begin(), list.end(), [](const QFileInfo &a, const QFileInfo &b) {
-                return a.lastModified() > b.lastModified();
+            std::stable_sort(children.begin(), children.end(), [&nodes](NodeId a, NodeId b) {
+                return nodes.modifiedTime(a) > nodes.modifiedTime(b);
+            });
+            break;
+            
+        case SortType::SIZE:
+            std::stable_sort(children.begin(), children.end(), [this, &nodes](NodeId a, NodeId b) {
+                return displayedSize(nodes, a) > displayedSize(nodes, b);
+            });
+            break;
+            
+        case SortType::ENTRY_COUNT:
+            std::stable_sort(children.begin(), children.end(), [&nodes](NodeId a, NodeId b) {
+                return nodes.descendantCount(a) > nodes.descendantCount(b);
             });
             break;
             
         case SortType::FILES_FIRST:
-            std::sort(list.begin(), list.end(), [](const QFileInfo &a, const QFileInfo &b) {
-                if (a.isFile() && b.isDir()) return true;
-                if (a.isDir() && b.isFile()) return false;
-                return a.fileName().toLower() < b.fileName().toLower();
+            std::stable_partition(children.begin(), children.end(), [&nodes](NodeId id) {
+                return !nodes.isDir(id);
             });
             break;
             
         case SortType::DIRS_FIRST:
-            std::sort(list.begin(), list.end(), [](const QFileInfo &a, const QFileInfo &b) {
-                if (a.isDir() && b.isFile()) return true;
-                if (a.isFile() && b.isDir()) return false;
-                return a.fileName().toLower() < b.fileName().toLower();
+            std::stable_partition(children.begin(), children.end(), [&nodes](NodeId id) {
+                return nodes.isDir(id);
             });
             break;
     }
-    
-    return list;
 }
 
-QString DirectoryTree::processDirectory(const QString &path, int depth)
+bool DirectoryTree::readDirectory(const QString &path, QVector<DirEntry> &entries)
 {
-    QString result;
-    QDir dir(path);
-    
-    // 设置过滤器
-    QDir::Filters filters = QDir::NoDotAndDotDot | QDir::AllEntries | QDir::NoSymLinks;
-    if (showHidden) {
-        filters |= QDir::Hidden;
+    // 追加到树中的条目总是带元数据，目录的汇总大小才能随按需读取和监视到的变化更新
+    if (!backend->listDirectory(path, showHidden, true, entries)) {
+        return false;
+    }
+    {
+        ProfileScope sortScope(ProfilePhase::SORT, entries.size());
+        sortEntries(entries, sortType);
     }
-    dir.setFilter(filters);
-    
-    // 获取排序后的文件列表
-    QFileInfoList list = getSortedEntries(dir);
     
-    // 检查深度限制
-    if (maxDepth > 0 && depth >= maxDepth) {
-        return result;
+    // 每个目录只更新一次共享计数器
+    qint64 bytes = 0;
+    for (const DirEntry &entry : entries) {
+        bytes += entry.size;
     }
+    entriesSeen.fetch_add(entries.size(), std::memory_order_relaxed);
+    bytesStatted.fetch_add(bytes, std::memory_order_relaxed);
     
-    for (int i = 0; i < list.size(); ++i) {
-        QFileInfo fileInfo = list.at(i);
-        processedItems++;
-        
-        // 检查是否应该忽略
-        if (shouldIgnore(fileInfo.fileName())) {
+    // 就地过滤掉被忽略的条目和不显示的文件
+    ProfileScope filterScope(ProfilePhase::FILTER, entries.size());
+    int kept = 0;
+    for (int i = 0; i < entries.size(); ++i) {
+        const DirEntry &entry = entries.at(i);
+        if (shouldIgnore(entry.name)) {
             continue;
         }
-        
-        QString indent = QString(indentChars).repeated(depth + 1);
-        
-        // 是否是最后一个项目
-        bool isLast = (i == list.size() - 1);
-        
-        QString prefix = isLast ? "└── " : "├── ";
-        
-        if (fileInfo.isDir()) {
-            result += indent + prefix + fileInfo.fileName() + "\n";
-            
-            // 为子目录添加正确的缩进前缀
-            QString childIndent = indent;
-            if (!isLast) {
-                childIndent.append("│   ");
-            } else {
-                childIndent.append("    ");
+        if (entry.isDir() || showFiles) {
+            if (kept != i) {
+                entries[kept] = entry;
             }
-            
-            QString subResult = processDirectory(fileInfo.filePath(), depth + 1);
-            if (!subResult.isEmpty()) {
-                result += subResult;
-            }
-        } else if (showFiles) {
-            result += indent + prefix + fileInfo.fileName() + "\n";
+            ++kept;
         }
     }
-    
-    return result;
+    entries.resize(kept);
+    return true;
 }
 
-QString DirectoryTree::processDirectoryMarkdown(const QString &path, int depth)
+QString DirectoryTree::renderTree(const ScannedTree &tree) const
 {
     QString result;
-    QDir dir(path);
-    
-    // 设置过滤器
-    QDir::Filters filters = QDir::NoDotAndDotDot | QDir::AllEntries | QDir::NoSymLinks;
-    if (showHidden) {
-        filters |= QDir::Hidden;
-    }
-    dir.setFilter(filters);
+    QTextStream out(&result);
+    renderTree(tree, out);
+    out.flush();
+    return result;
+}
+
+void DirectoryTree::renderTree(const ScannedTree &tree, QTextStream &out) const
+{
+    static const QString branch = QStringLiteral("├── ");
+    static const QString lastBranch = QStringLiteral("└── ");
+    static const QString listItem = QStringLiteral("- ");
     
-    // 获取排序后的文件列表
-    QFileInfoList list = getSortedEntries(dir);
+    ProfileScope renderScope(ProfilePhase::RENDER, tree.nodes.size());
+    const NodeStore &nodes = tree.nodes;
+    const bool markdown = outputFormat == OutputFormat::MARKDOWN;
+    const QString indentUnit = markdown ? QStringLiteral("  ") : indentChars;
     
-    // 检查深度限制
-    if (maxDepth > 0 && depth >= maxDepth) {
-        return result;
+    out << nodes.name(tree.root);
+    if (sizeMode != SizeMode::NONE) {
+        out << sizeSuffix(nodes, tree.root);
     }
+    out << '\n';
     
-    for (int i = 0; i < list.size(); ++i) {
-        QFileInfo fileInfo = list.at(i);
-        processedItems++;
-        
-        // 检查是否应该忽略
-        if (shouldIgnore(fileInfo.fileName())) {
+    // 非递归的先序遍历，一次写出所有行。
+    // 前缀栈：进入子目录时在 prefix 末尾追加一段缩进，返回时截掉，不再为每一项重建缩进
+    struct Frame {
+        NodeId node;
+        int next;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({tree.root, 0});
+    QString prefix = indentUnit;
+    
+    while (!stack.empty()) {
+        Frame &frame = stack.back();
+        int count = nodes.childCount(frame.node);
+        if (frame.next >= count) {
+            stack.pop_back();
+            prefix.chop(indentUnit.size());
             continue;
         }
         
-        QString indent = QString("  ").repeated(depth + 1);
+        int index = frame.next++;
+        NodeId child = nodes.child(frame.node, index);
+        out << prefix;
+        if (markdown) {
+            out << listItem;
+        } else {
+            out << (index == count - 1 ? lastBranch : branch);
+        }
+        out << nodes.name(child);
+        if (sizeMode != SizeMode::NONE) {
+            out << sizeSuffix(nodes, child);
+        }
+        out << '\n';
         
-        if (fileInfo.isDir()) {
-            result += indent + "- " + fileInfo.fileName() + "\n";
-            QString subResult = processDirectoryMarkdown(fileInfo.filePath(), depth + 1);
-            if (!subResult.isEmpty()) {
-                result += subResult;
-            }
-        } else if (showFiles) {
-            result += indent + "- " + fileInfo.fileName() + "\n";
+        if (nodes.childCount(child) > 0) {
+            stack.push_back({child, 0});
+            prefix += indentUnit;
         }
     }
-    
-    return result;
 }
 
-QJsonArray DirectoryTree::processDirectoryJson(const QString &path, int depth)
+bool DirectoryTree::writeJsonTree(const ScannedTree &tree, QIODevice *device, QString *errorString)
 {
-    QJsonArray result;
-    QDir dir(path);
+    totalItems = tree.nodes.size();
+    processedItems = 0;
     
-    // 设置过滤器
-    QDir::Filters filters = QDir::NoDotAndDotDot | QDir::AllEntries | QDir::NoSymLinks;
-    if (showHidden) {
-        filters |= QDir::Hidden;
+    ProfileScope renderScope(ProfilePhase::RENDER, tree.nodes.size());
+    JsonTreeWriter writer(device);
+    writer.setMaxDepth(maxDepth);
+    writer.setProgress(&processedItems, &cancelRequested);
+    bool ok = writer.writeJson(tree);
+    if (errorString) {
+        *errorString = writer.errorString();
     }
-    dir.setFilter(filters);
+    return ok;
+}
+
+bool DirectoryTree::writeNdjsonTree(const ScannedTree &tree, QIODevice *device, QString *errorString)
+{
+    totalItems = tree.nodes.size();
+    processedItems = 0;
     
-    // 获取排序后的文件列表
-    QFileInfoList list = getSortedEntries(dir);
+    ProfileScope renderScope(ProfilePhase::RENDER, tree.nodes.size());
+    JsonTreeWriter writer(device);
+    writer.setProgress(&processedItems, &cancelRequested);
+    bool ok = writer.writeNdjson(tree);
+    if (errorString) {
+        *errorString = writer.errorString();
+    }
+    return ok;
+}
+
+QString DirectoryTree::renderLine(const ScannedTree &tree, NodeId node) const
+{
+    const NodeStore &nodes = tree.nodes;
+    QString name = nodes.name(node);
+    if (sizeMode != SizeMode::NONE) {
+        name += sizeSuffix(nodes, node);
+    }
+    if (node == tree.root) {
+        return name;
+    }
     
-    // 检查深度限制
-    if (maxDepth > 0 && depth >= maxDepth) {
-        return result;
+    // 与 renderTree 输出的行完全一致
+    int depth = nodes.depth(node);
+    if (outputFormat == OutputFormat::MARKDOWN) {
+        return QString("  ").repeated(depth) + "- " + name;
     }
     
-    for (int i = 0; i < list.size(); ++i) {
-        QFileInfo fileInfo = list.at(i);
-        processedItems++;
-        
-        // 检查是否应该忽略
-        if (shouldIgnore(fileInfo.fileName())) {
-            continue;
+    NodeId parent = nodes.parent(node);
+    bool isLast = nodes.row(node) == nodes.childCount(parent) - 1;
+    return indentChars.repeated(depth) + (isLast ? "└── " : "├── ") + name;
+}
+
+qint64 DirectoryTree::displayedSize(const NodeStore &nodes, NodeId node) const
+{
+    return sizeMode == SizeMode::ALLOCATED ? nodes.allocatedSize(node) : nodes.apparentSize(node);
+}
+
+QString DirectoryTree::sizeSuffix(const NodeStore &nodes, NodeId node) const
+{
+    return QStringLiteral("  (") + QLocale().formattedDataSize(displayedSize(nodes, node)) + QLatin1Char(')');
+}
+
+QJsonObject DirectoryTree::renderJsonTree(const ScannedTree &tree) const
+{
+    QJsonObject root;
+    root["name"] = tree.nodes.name(tree.root);
+    root["path"] = tree.rootPath;
+    root["type"] = "directory";
+    root["children"] = processDirectoryJson(tree.nodes, tree.root, tree.rootPath, 0);
+    
+    return root;
+}
+
+QString DirectoryTree::generateTree(const QString &rootPath)
+{
+    return renderTree(*scan(rootPath));
+}
+
+QJsonObject DirectoryTree::generateJsonTree(const QString &rootPath)
+{
+    return renderJsonTree(*scan(rootPath));
+}
+
+bool DirectoryTree::shouldIgnore(const QString &name) const
+{
+    return ignoreMatcher.matches(name);
+}
+
+void DirectoryTree::sortEntries(QVector<DirEntry> &entries, SortType type) const
+{
+    // 每个条目只计算一次排序键，再对键排序；比较时不再转换大小写或分配内存
+    std::vector<SortKey> keys;
+    keys.reserve(size_t(entries.size()));
+    for (int i = 0; i < entries.size(); ++i) {
+        const DirEntry &entry = entries.at(i);
+        SortKey key;
+        key.index = i;
+        switch (type) {
+            case SortType::NAME:
+                key.text = nameKey(entry.name);
+                break;
+            case SortType::NATURAL:
+                key.text = naturalKey(entry.name);
+                break;
+            case SortType::MODIFIED_TIME:
+                // 修改时间相同的按名称排序，与 project 中在名称顺序上做稳定排序的结果一致
+                key.value = -entry.modifiedTime;
+                key.text = nameKey(entry.name);
+                break;
+            case SortType::SIZE:
+                // 刚列出的子目录还没有汇总大小，排在文件之前并按名称排序
+                key.group = entry.isDir() ? 0 : 1;
+                if (!entry.isDir()) {
+                    key.value = -(sizeMode == SizeMode::ALLOCATED ? entry.allocatedSize : entry.size);
+                }
+                key.text = nameKey(entry.name);
+                break;
+            case SortType::ENTRY_COUNT:
+                // 单独列出时不知道子目录的条目数，按目录优先、名称排序
+                key.group = entry.isDir() ? 0 : 1;
+                key.text = nameKey(entry.name);
+                break;
+            case SortType::FILES_FIRST:
+                key.group = entry.isDir() ? 1 : 0;
+                key.text = nameKey(entry.name);
+                break;
+            case SortType::DIRS_FIRST:
+                key.group = entry.isDir() ? 0 : 1;
+                key.text = nameKey(entry.name);
+                break;
         }
+        keys.push_back(std::move(key));
+    }
+    std::sort(keys.begin(), keys.end());
+    
+    QVector<DirEntry> sorted;
+    sorted.reserve(entries.size());
+    for (const SortKey &key : keys) {
+        sorted.append(std::move(entries[key.index]));
+    }
+    entries.swap(sorted);
+}
+
+QJsonArray DirectoryTree::processDirectoryJson(const NodeStore &nodes, NodeId node, const QString &path, int depth) const
+{
+    QJsonArray result;
+    QDir dir(path);
+    int count = nodes.childCount(node);
+    
+    for (int i = 0; i < count; ++i) {
+        NodeId child = nodes.child(node, i);
+        QString name = nodes.name(child);
         
         QJsonObject item;
-        item["name"] = fileInfo.fileName();
-        item["path"] = fileInfo.filePath();
+        item["name"] = name;
+        item["path"] = dir.filePath(name);
         
-        if (fileInfo.isDir()) {
+        if (nodes.isDir(child)) {
             item["type"] = "directory";
             if (maxDepth <= 0 || depth + 1 < maxDepth) {
-                item["children"] = processDirectoryJson(fileInfo.filePath(), depth + 1);
+                item["children"] = processDirectoryJson(nodes, child, dir.filePath(name), depth + 1);
             }
-            result.append(item);
-        } else if (showFiles) {
+        } else {
             item["type"] = "file";
-            result.append(item);
         }
+        result.append(item);
     }
     
     return result;
-} 
\ No newline at end of file
+}
\ No newline at end of file
@@ -6,6 +6,20 @@
 #include <QSet>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <array>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include "FileIdSet.h"
+#include "FileSystemBackend.h"
+#include "NodeStore.h"
+#include "SyntheticBackend.h"
+#include "IgnoreMatcher.h"
+
+class QIODevice;
+class QTextStream;
+class DevicePools;
 
 enum class OutputFormat {
     TEXT,
@@ -17,12 +31,67 @@ enum class SortType {
     NAME,
     MODIFIED_TIME,
     FILES_FIRST,
-    DIRS_FIRST
+    DIRS_FIRST,
+    NATURAL,        // 按名称，连续的数字按数值比较（file2 在 file10 之前）
+    SIZE,           // 按大小从大到小，目录按其下所有文件之和
+    ENTRY_COUNT     // 按目录下（递归）的条目数从多到少
+};
+
+// 文本输出中显示的大小，同时决定按大小排序时比较哪一个
+enum class SizeMode {
+    NONE,
+    APPARENT,       // 文件大小之和
+    ALLOCATED       // 实际占用的磁盘空间之和（与 du 相同）
+};
+
+// 目录树，各目录的子节点在 nodes 中连续存放。有两种用途：
+// 扫描得到的超集树保留所有条目（含文件、隐藏项和被忽略的项）及其修改时间，子节点按名称排序；
+// 由它按当前的显示选项投影出的树才是文本、Markdown、JSON 输出和层级视图共享的结果，
+// 子节点已按排序方式排好。扫描结束后只有 GUI 线程会修改投影出的树
+// （层级视图展开尚未读取的目录、实时更新）
+struct ScannedTree {
+    QString rootPath;
+    QString scanKey;        // 生成这棵树时的扫描选项，选项变化后需要重新扫描
+    NodeStore nodes;
+    NodeId root = 0;
+    qint64 scannedItems = 0;
+    qint64 scanStartedAt = 0;  // 扫描开始时刻（毫秒时间戳），用于判断目录修改时间是否可信
+    bool complete = false;  // 深度限制内的目录是否都已读取；浅扫描得到的树为 false
+    bool memoryLimited = false;  // 达到内存上限，部分目录只有汇总而没有列出条目（仍可在层级视图中按需展开）
+    
+    // 以下只对超集树有意义：扫描时没有进入的范围，决定它能投影出哪些选项的结果
+    int depthLimit = -1;            // 扫描深度限制，-1 表示不限
+    bool hiddenPruned = false;      // 没有进入隐藏目录
+    bool followedSymlinks = false;  // 跟随了符号链接
+    bool oneFileSystem = false;     // 没有进入根目录所在文件系统以外的目录
+    bool browsedArchives = false;   // 压缩包作为目录读取了其中的条目
+    QStringList prunedPatterns;     // 没有进入匹配这些忽略模式的目录
+    
+    QString path(NodeId id) const { return nodes.path(id, rootPath); }
+};
+
+// 扫描进度快照。计数器由扫描线程更新，速率和剩余时间由 ScanSession 根据耗时估算
+struct ScanProgress {
+    qint64 dirsDiscovered = 0;   // 已发现、需要读取的目录（含根目录）
+    qint64 dirsCompleted = 0;    // 已读取完的目录
+    qint64 entriesSeen = 0;      // 已列出的条目（过滤之前）
+    qint64 bytesStatted = 0;     // 已获取元数据的条目大小之和
+    qint64 memoryBytes = 0;      // 正在生成的树（重新验证时含缓存的树）占用的内存
+    qint64 elapsedMs = 0;
+    double entriesPerSecond = 0;
+    qint64 remainingMs = -1;     // -1 表示暂时无法估计
+    int percent = -1;            // -1 表示暂时无法估计
+    // 按深度分别统计的已发现和已读取完的目录数，用于估计剩余的工作量；最后一项包含更深的所有目录
+    std::vector<qint64> discoveredByDepth;
+    std::vector<qint64> completedByDepth;
 };
 
 class DirectoryTree
 {
 public:
+    // 修改时间距上次扫描开始不到这么久的目录，重新验证时总是重新读取
+    static constexpr qint64 RACY_MODIFICATION_WINDOW_MS = 2000;
+    
     DirectoryTree();
     
     void setMaxDepth(int depth);
@@ -31,12 +100,90 @@ public:
     void setShowHidden(bool show);
     void setIgnorePatterns(const QStringList &patterns);
     void setSortType(SortType type);
+    void setSizeMode(SizeMode mode);
     void setOutputFormat(OutputFormat format);
+    void setThreadCount(int count);
+    void setScannerBackend(ScannerBackend type);
+    void setUseIoUring(bool enable);
+    // ScannerBackend::SYNTHETIC 使用的内存目录树和注入的延迟；扫描路径为树内的路径（"/" 为树根）
+    void setSyntheticFileSystem(std::shared_ptr<const SyntheticFileSystem> fileSystem,
+                                const SyntheticLatency &latency = SyntheticLatency());
+    // 跟随指向目录和文件的符号链接。每个目录（按设备和 inode 识别）只读取一次，
+    // 指回祖先的链接和经多条路径到达的目录在其余位置作为未读取的节点保留。
+    // 读取的位置取先序遍历中最先出现的一处，为此跟随符号链接时总是单线程扫描
+    void setFollowSymlinks(bool follow);
+    // 只扫描根目录所在的文件系统（与 find -xdev 相同），其他设备的挂载点作为未读取的节点保留
+    void setOneFileSystem(bool enable);
+    // 把 zip、tar（以及有 zlib 时的 tar.gz）文件当作目录，列出其中的条目而不解压。
+    // 压缩包节点的大小仍是文件本身占用的，不累加其中条目解压后的大小
+    void setBrowseArchives(bool enable);
+    // 扫描可以使用的内存（字节），0 表示不限。投影出的树最多与超集树一样大，
+    // 因此超集树只使用其中一半；达到上限后不再把新的目录加入树中，它们作为只有汇总大小和条目数的
+    // 节点保留（其中的条目在层级视图中展开时再读取）
+    void setMemoryBudget(qint64 bytes);
+    // 默认的内存上限：物理内存的一半，无法获取时为 4 GB
+    static qint64 defaultMemoryBudget();
+    
+    // 扫描目录得到超集树，线程数大于1时每个子目录作为一个任务并行扫描。
+    // 只有深度限制、被忽略的目录和（不显示隐藏项时）隐藏目录决定不进入哪些目录，
+    // 其余选项都在投影时应用。shallow 为 true 时只读取根目录一层，其余目录留给层级视图按需展开
+    std::shared_ptr<ScannedTree> scanSource(const QString &rootPath, bool shallow = false);
+    // 扫描并按当前选项投影
+    std::shared_ptr<ScannedTree> scan(const QString &rootPath, bool shallow = false);
+    
+    // 按当前的深度、显示、忽略和排序选项从超集树生成结果，不访问磁盘。
+    // 排序直接利用超集树中已按名称排好的顺序和保存的修改时间
+    std::shared_ptr<ScannedTree> project(const ScannedTree &source) const;
+    // source 是否包含当前选项需要的全部目录（否则必须重新扫描）
+    bool covers(const ScannedTree &source) const;
+    // 决定超集树内容的选项组合，用于磁盘快照
+    QString sourceKey(const QString &rootPath) const;
+    
+    // 以缓存的超集树为基础重新扫描：目录修改时间未变的直接沿用缓存中的子项，
+    // 只重新读取有变化的目录。cached 的 sourceKey 必须与当前一致
+    std::shared_ptr<ScannedTree> revalidate(const ScannedTree &cached);
+    // 最近一次 revalidate 重新读取的目录数
+    qint64 getRelistedDirectories() const { return relistedDirectories.load(std::memory_order_relaxed); }
+    
+    // 按需读取单个目录：返回排序并过滤后的子项，由调用方追加到树中
+    bool canPopulate(const ScannedTree &tree, NodeId node) const;
+    QVector<DirEntry> listChildren(const QString &path);
+    // 重新读取树中已有的目录 dir（监视到变化时），由调用方替换它的子节点。
+    // 名称相同的子目录沿用树中已汇总的大小、条目数和修改时间参与排序，结果与 project 的顺序一致
+    QVector<DirEntry> relistChildren(const ScannedTree &tree, NodeId dir);
+    // 通过当前的扫描后端获取单个目录或文件的元数据
+    bool statPath(const QString &path, DirEntry &entry);
+    // 排序或显示是否依赖条目的元数据（修改时间等），依赖时文件内容的变化也会影响结果
+    bool needsMetadata() const
+    {
+        return sortType == SortType::MODIFIED_TIME || sortType == SortType::SIZE || sizeMode != SizeMode::NONE;
+    }
+    // 影响扫描结果的选项组合；缩进和输出格式只影响渲染，不在其中
+    QString scanKey(const QString &rootPath) const;
+    
+    // 把已扫描的树渲染为文本/Markdown 或 JSON，不访问磁盘
+    QString renderTree(const ScannedTree &tree) const;
+    // 一次遍历直接写入流（文件、标准输出、管道），内存占用与树的大小无关
+    void renderTree(const ScannedTree &tree, QTextStream &out) const;
+    QJsonObject renderJsonTree(const ScannedTree &tree) const;
+    // 流式写出 JSON（与 renderJsonTree 的缩进输出一致）或 NDJSON（每行一个节点）。
+    // 写入时更新进度计数，可通过 requestCancel 中止；失败或取消时返回 false
+    bool writeJsonTree(const ScannedTree &tree, QIODevice *device, QString *errorString = nullptr);
+    bool writeNdjsonTree(const ScannedTree &tree, QIODevice *device, QString *errorString = nullptr);
+    // 单个节点在文本/Markdown 输出中对应的一行（不含换行符），供按行显示的视图使用
+    QString renderLine(const ScannedTree &tree, NodeId node) const;
     
     QString generateTree(const QString &rootPath);
     QJsonObject generateJsonTree(const QString &rootPath);
-    int getTotalItems() const { return totalItems; }
-    int getProcessedItems() const { return processedItems; }
+    // 导出等逐项处理的进度
+    int getTotalItems() const { return totalItems.load(std::memory_order_relaxed); }
+    int getProcessedItems() const { return processedItems.load(std::memory_order_relaxed); }
+    // 扫描计数器的快照（可从任意线程调用）
+    ScanProgress progress() const;
+    
+    // 取消正在进行的扫描（可从任意线程调用）
+    void requestCancel();
+    bool isCancelled() const;
 
 private:
     int maxDepth;
@@ -44,17 +191,70 @@ private:
     bool showFiles;
     bool showHidden;
     QStringList ignorePatterns;
-    QSet<QString> ignoredDirs;
+    IgnoreMatcher ignoreMatcher;  // 由 ignorePatterns 预编译而来
     SortType sortType;
+    SizeMode sizeMode;
     OutputFormat outputFormat;
-    int totalItems;
-    int processedItems;
+    int threadCount;
+    ScannerBackend scannerBackend;
+    bool useIoUring;
+    std::shared_ptr<const SyntheticFileSystem> syntheticFileSystem;
+    SyntheticLatency syntheticLatency;
+    bool followSymlinks;
+    bool oneFileSystem;
+    bool browseArchives;
+    qint64 memoryBudget;
+    std::unique_ptr<FileSystemBackend> backend;
+    int scanDepthLimit;     // 本次扫描实际使用的深度限制
+    qint64 trustedBefore;   // 重新验证时，早于此时刻的目录修改时间才可信
+    quint64 rootDevice;     // 本次扫描的根目录所在的设备
+    std::atomic<int> totalItems;
+    std::atomic<int> processedItems;
+    std::atomic<qint64> dirsDiscovered;
+    std::atomic<qint64> dirsCompleted;
+    static constexpr int DEPTH_STATS = 64;
+    std::array<std::atomic<qint64>, DEPTH_STATS> dirsDiscoveredAtDepth;
+    std::array<std::atomic<qint64>, DEPTH_STATS> dirsCompletedAtDepth;
+    std::atomic<qint64> entriesSeen;
+    std::atomic<qint64> bytesStatted;
+    std::atomic<qint64> relistedDirectories;
+    std::atomic<qint64> treeMemory;         // 扫描中的树占用的内存，每读完一个目录更新一次
+    std::atomic<bool> memoryLimitReached;
+    qint64 memoryBaseline;                  // 扫描期间同时保留的缓存树
+    std::atomic<bool> cancelRequested;
+    std::mutex storeMutex;  // 并行扫描时保护节点存储的追加
+    FileIdSet visitedDirectories;  // 本次扫描已读取的目录，只在跟随符号链接时记录
+    FileIdSet seenFiles;           // 已计入汇总的硬链接文件（跟随符号链接时为全部文件）
+    std::vector<std::pair<FileId, NodeId>> linkedFiles;  // 并行扫描时读到的硬链接及其节点，扫描结束后统一判定
     
-    QString processDirectory(const QString &path, int depth);
-    QString processDirectoryMarkdown(const QString &path, int depth);
-    QJsonArray processDirectoryJson(const QString &path, int depth);
+    QString rootNameOf(const QString &rootPath) const;
+    void initSource(ScannedTree &tree, const QString &rootPath) const;
+    void ensureBackend();
+    bool readDirectory(const QString &path, QVector<DirEntry> &entries);
+    bool readSourceDirectory(const QString &path, QVector<DirEntry> &entries);
+    // 遍历 path 下的所有条目，只把大小和条目数记在 node 上，不为它们创建节点
+    void summarizeDirectory(ScannedTree &tree, NodeId node, const QString &path);
+    // 重新获取 path 下沿用的文件（及压缩包）的大小和修改时间，返回是否有变化
+    bool restatFiles(const QString &path, QVector<DirEntry> &entries);
+    bool isPruned(const DirEntry &entry) const;
+    // 进度计数：depth 层的一个目录加入待读取的队列 / 读取完毕
+    void discoverDirectory(int depth);
+    void completeDirectory(int depth);
+    void resetDirectoryCounts();
+    // 同一文件可能在树中多处出现、只应计入一次的条目
+    bool countsOnce(const DirEntry &entry) const;
+    // 并行扫描结束后，为每组硬链接选出单线程扫描时最先到达的一处计入汇总，其余标记为重复
+    void resolveLinkedFiles(ScannedTree &tree);
+    void orderChildren(const NodeStore &nodes, std::vector<NodeId> &children) const;
+    void runScan(ScannedTree &tree, const ScannedTree *cached);
+    void scanDirectory(ScannedTree &tree, NodeId node, const QString &path, int depth, DevicePools *pools,
+                       const ScannedTree *cached = nullptr, NodeId cachedNode = INVALID_NODE);
+    void copyChildren(const NodeStore &nodes, NodeId node, QVector<DirEntry> &entries);
+    QJsonArray processDirectoryJson(const NodeStore &nodes, NodeId node, const QString &path, int depth) const;
     bool shouldIgnore(const QString &name) const;
-    QFileInfoList getSortedEntries(const QDir &dir) const;
+    qint64 displayedSize(const NodeStore &nodes, NodeId node) const;
+    QString sizeSuffix(const NodeStore &nodes, NodeId node) const;
+    void sortEntries(QVector<DirEntry> &entries, SortType type) const;
 };
 
 #endif // DIRECTORYTREE_H 
\ No newline at end of file
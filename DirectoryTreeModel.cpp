@@ -0,0 +1,270 @@
+#include "DirectoryTreeModel.h"
+#include <QHash>
+#include <QLocale>
+
+DirectoryTreeModel::DirectoryTreeModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+}
+
+void DirectoryTreeModel::setTree(const std::shared_ptr<ScannedTree> &tree, DirectoryTree *lister)
+{
+    beginResetModel();
+    this->tree = tree;
+    this->lister = lister;
+    endResetModel();
+}
+
+void DirectoryTreeModel::clear()
+{
+    setTree(nullptr, nullptr);
+}
+
+void DirectoryTreeModel::setIcons(const QIcon &dirIcon, const QIcon &fileIcon)
+{
+    this->dirIcon = dirIcon;
+    this->fileIcon = fileIcon;
+}
+
+QModelIndex DirectoryTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+
+    // 顶层只有根目录一行
+    if (!parent.isValid()) {
+        return createIndex(row, column, quintptr(tree->root));
+    }
+
+    return createIndex(row, column, quintptr(tree->nodes.child(nodeOf(parent), row)));
+}
+
+QModelIndex DirectoryTreeModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid() || !tree) {
+        return QModelIndex();
+    }
+
+    NodeId node = nodeOf(child);
+    if (node == tree->root) {
+        return QModelIndex();
+    }
+
+    NodeId parentNode = tree->nodes.parent(node);
+    int row = parentNode == tree->root ? 0 : tree->nodes.row(parentNode);
+    return createIndex(row, 0, quintptr(parentNode));
+}
+
+int DirectoryTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (!tree) {
+        return 0;
+    }
+    if (!parent.isValid()) {
+        return 1;
+    }
+    if (parent.column() > 0) {
+        return 0;
+    }
+
+    return tree->nodes.childCount(nodeOf(parent));
+}
+
+int DirectoryTreeModel::columnCount(const QModelIndex &) const
+{
+    return ColumnCount;
+}
+
+bool DirectoryTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return tree != nullptr;
+    }
+    if (parent.column() > 0) {
+        return false;
+    }
+
+    // 未读取的目录先显示展开标记，展开时再列出；树被冻结期间标记照常显示
+    if (lister && lister->canPopulate(*tree, nodeOf(parent))) {
+        return true;
+    }
+    return tree->nodes.childCount(nodeOf(parent)) > 0;
+}
+
+QVariant DirectoryTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || !tree) {
+        return QVariant();
+    }
+
+    const NodeStore &nodes = tree->nodes;
+    NodeId node = nodeOf(index);
+    bool isDir = nodes.isDir(node);
+
+    if (role == Qt::DecorationRole && index.column() == NameColumn) {
+        return isDir ? dirIcon : fileIcon;
+    }
+    if (role == Qt::TextAlignmentRole && (index.column() == SizeColumn || index.column() == AllocatedColumn)) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if (role == Qt::ToolTipRole && index.column() == NameColumn) {
+        // 路径不保存在节点中，只在需要提示时重建
+        return tree->path(node);
+    }
+    if (role != Qt::DisplayRole && role != Qt::ToolTipRole) {
+        return QVariant();
+    }
+
+    // 目录只有其下的目录都已读取时汇总大小才完整，否则不显示（层级视图的浅扫描中多数目录如此）；
+    // 压缩包的大小是文件本身的，总是已知
+    bool sizeKnown = !isDir || nodes.isComplete(node) || nodes.isArchive(node);
+    switch (index.column()) {
+        case NameColumn:
+            return nodes.name(node);
+        case TypeColumn:
+            if (nodes.isArchive(node)) {
+                return QString("压缩包");
+            }
+            if (nodes.isSymlink(node)) {
+                return isDir ? QString("文件夹链接") : QString("文件链接");
+            }
+            return isDir ? QString("文件夹") : QString("文件");
+        case SizeColumn:
+            return sizeKnown ? QLocale().formattedDataSize(nodes.apparentSize(node)) : QString();
+        case AllocatedColumn:
+            return sizeKnown ? QLocale().formattedDataSize(nodes.allocatedSize(node)) : QString();
+        default:
+            return QVariant();
+    }
+}
+
+QVariant DirectoryTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (section) {
+        case NameColumn:
+            return QString("名称");
+        case TypeColumn:
+            return QString("类型");
+        case SizeColumn:
+            return QString("大小");
+        case AllocatedColumn:
+            return QString("占用空间");
+        default:
+            return QVariant();
+    }
+}
+
+bool DirectoryTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (!parent.isValid() || !tree || !lister || tree.get() == frozenTree) {
+        return false;
+    }
+
+    return lister->canPopulate(*tree, nodeOf(parent));
+}
+
+void DirectoryTreeModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+
+    // 扫描选项已经改变时不再往旧树中追加，等待新的扫描结果
+    if (lister->scanKey(tree->rootPath) != tree->scanKey) {
+        return;
+    }
+
+    NodeId node = nodeOf(parent);
+    QVector<DirEntry> entries = lister->listChildren(tree->path(node));
+
+    // 读取失败或目录为空时也标记为已读取，不再重复尝试
+    if (entries.isEmpty()) {
+        tree->nodes.appendChildren(node, entries);
+        emit dataChanged(parent, parent);
+    } else {
+        beginInsertRows(parent, 0, entries.size() - 1);
+        tree->nodes.appendChildren(node, entries);
+        endInsertRows();
+    }
+
+    // 新读取的条目计入本目录和上级的汇总，上级可能因此变为完整
+    tree->nodes.updateAggregates(node);
+    for (NodeId ancestor = node; ancestor != INVALID_NODE; ancestor = tree->nodes.parent(ancestor)) {
+        QModelIndex ancestorIndex = indexOf(ancestor);
+        emit dataChanged(ancestorIndex.siblingAtColumn(SizeColumn), ancestorIndex.siblingAtColumn(AllocatedColumn));
+    }
+    emit directoryPopulated(node);
+}
+
+QModelIndex DirectoryTreeModel::indexOf(NodeId node) const
+{
+    int row = node == tree->root ? 0 : tree->nodes.row(node);
+    return createIndex(row, 0, quintptr(node));
+}
+
+void DirectoryTreeModel::beginDirectoryChange(NodeId dir)
+{
+    changingParents = {QPersistentModelIndex(indexOf(dir))};
+    emit layoutAboutToBeChanged(changingParents);
+}
+
+void DirectoryTreeModel::endDirectoryChange(NodeId dir, NodeId oldFirstChild, int oldCount)
+{
+    const NodeStore &nodes = tree->nodes;
+    QHash<QString, int> newRows;
+    QModelIndexList from;
+    QModelIndexList to;
+
+    // 原来的子节点按名称对应到新的行；孙节点及更深的节点编号不变，无需处理
+    const QModelIndexList persistent = persistentIndexList();
+    for (const QModelIndex &index : persistent) {
+        NodeId node = nodeOf(index);
+        if (node < oldFirstChild || node >= oldFirstChild + NodeId(oldCount)) {
+            continue;
+        }
+
+        if (newRows.isEmpty()) {
+            for (int i = 0; i < nodes.childCount(dir); ++i) {
+                newRows.insert(nodes.name(nodes.child(dir, i)), i);
+            }
+        }
+
+        int row = newRows.value(nodes.name(node), -1);
+        from.append(index);
+        to.append(row < 0 ? QModelIndex() : createIndex(row, index.column(), quintptr(nodes.child(dir, row))));
+    }
+    changePersistentIndexList(from, to);
+
+    emit layoutChanged(changingParents);
+    changingParents.clear();
+}
+
+void DirectoryTreeModel::beginCompaction()
+{
+    emit layoutAboutToBeChanged();
+}
+
+void DirectoryTreeModel::endCompaction(const std::vector<NodeId> &oldToNew)
+{
+    QModelIndexList from;
+    QModelIndexList to;
+
+    const QModelIndexList persistent = persistentIndexList();
+    for (const QModelIndex &index : persistent) {
+        NodeId node = oldToNew[nodeOf(index)];
+        from.append(index);
+        if (node == INVALID_NODE) {
+            to.append(QModelIndex());
+        } else {
+            to.append(createIndex(indexOf(node).row(), index.column(), quintptr(node)));
+        }
+    }
+    changePersistentIndexList(from, to);
+
+    emit layoutChanged();
+}
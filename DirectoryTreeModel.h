@@ -0,0 +1,72 @@
+#ifndef DIRECTORYTREEMODEL_H
+#define DIRECTORYTREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QIcon>
+#include <memory>
+#include <vector>
+#include "DirectoryTree.h"
+
+// 层级视图使用的模型，行数据直接取自扫描得到的 NodeStore，不为每个单元格创建对象。
+// 尚未读取的目录在用户展开时才通过 canFetchMore/fetchMore 列出，
+// 内存占用随已展开的部分增长。索引的 internalId 就是节点编号。
+// 完整路径不再单独占一列，只在名称的提示中显示
+class DirectoryTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        NameColumn,
+        TypeColumn,
+        SizeColumn,         // 文件大小，目录为其下所有文件之和
+        AllocatedColumn,    // 实际占用的磁盘空间
+        ColumnCount
+    };
+
+    explicit DirectoryTreeModel(QObject *parent = nullptr);
+
+    // lister 用于按需读取目录，其选项应与生成 tree 时一致
+    void setTree(const std::shared_ptr<ScannedTree> &tree, DirectoryTree *lister);
+    void clear();
+    void setIcons(const QIcon &dirIcon, const QIcon &fileIcon);
+    std::shared_ptr<ScannedTree> currentTree() const { return tree; }
+    // 其他线程（导出）正在读取 frozen 时不再按需读取其中的目录：追加节点会使存储重新分配。
+    // 完整的树中也可能有未读取的目录（其他文件系统的挂载点、经符号链接重复到达的目录）。nullptr 解除
+    void setFrozenTree(const ScannedTree *frozen) { frozenTree = frozen; }
+
+    // 树在原处被修改（TreeWatcher 应用目录变化、整理存储）前后调用。
+    // 以布局变化通知视图，并把持久索引换到新的节点编号上，展开状态和选择得以保留
+    void beginDirectoryChange(NodeId dir);
+    void endDirectoryChange(NodeId dir, NodeId oldFirstChild, int oldCount);
+    void beginCompaction();
+    void endCompaction(const std::vector<NodeId> &oldToNew);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+signals:
+    // 按需读取了一个目录
+    void directoryPopulated(NodeId node);
+
+private:
+    std::shared_ptr<ScannedTree> tree;
+    DirectoryTree *lister = nullptr;
+    QIcon dirIcon;
+    QIcon fileIcon;
+    QList<QPersistentModelIndex> changingParents;
+    const ScannedTree *frozenTree = nullptr;
+
+    QModelIndex indexOf(NodeId node) const;
+    NodeId nodeOf(const QModelIndex &index) const { return NodeId(index.internalId()); }
+};
+
+#endif // DIRECTORYTREEMODEL_H
@@ -0,0 +1,116 @@
+#include "ExportSession.h"
+#include <QSaveFile>
+#include <QTextStream>
+
+ExportSession::ExportSession(QObject *parent)
+    : QObject(parent), worker(nullptr), progressTimer(new QTimer(this)),
+      exportFormat(ExportFormat::TEXT), success(false)
+{
+    // 与扫描会话相同，GUI 线程定时读取写入线程更新的原子计数器
+    progressTimer->setInterval(100);
+    connect(progressTimer, &QTimer::timeout, this, &ExportSession::reportProgress);
+}
+
+ExportSession::~ExportSession()
+{
+    cancel();
+    if (worker) {
+        worker->wait();
+    }
+}
+
+void ExportSession::start(const std::shared_ptr<ScannedTree> &tree, const QString &filePath, ExportFormat format)
+{
+    if (worker) {
+        return;
+    }
+
+    targetPath = filePath;
+    exportFormat = format;
+
+    // 工作线程持有树的引用，导出期间即使缓存淘汰了它也不会被释放
+    worker = QThread::create([this, tree]() {
+        success = writeFile(*tree);
+    });
+    worker->setParent(this);
+    connect(worker, &QThread::finished, this, &ExportSession::onWorkerFinished);
+
+    progressTimer->start();
+    worker->start();
+}
+
+bool ExportSession::writeFile(const ScannedTree &tree)
+{
+    QSaveFile file(targetPath);
+    bool textMode = exportFormat == ExportFormat::TEXT || exportFormat == ExportFormat::MARKDOWN;
+    QIODevice::OpenMode mode = textMode ? QIODevice::WriteOnly | QIODevice::Text : QIODevice::WriteOnly;
+    if (!file.open(mode)) {
+        error = file.errorString();
+        return false;
+    }
+
+    bool ok = true;
+    switch (exportFormat) {
+        case ExportFormat::TEXT:
+        case ExportFormat::MARKDOWN: {
+            dirTree.setOutputFormat(exportFormat == ExportFormat::MARKDOWN ? OutputFormat::MARKDOWN : OutputFormat::TEXT);
+            QTextStream out(&file);
+            dirTree.renderTree(tree, out);
+            out.flush();
+            ok = out.status() == QTextStream::Ok;
+            if (!ok) {
+                error = file.errorString();
+            }
+            break;
+        }
+        case ExportFormat::JSON:
+            ok = dirTree.writeJsonTree(tree, &file, &error);
+            break;
+        case ExportFormat::NDJSON:
+            ok = dirTree.writeNdjsonTree(tree, &file, &error);
+            break;
+    }
+
+    if (!ok || dirTree.isCancelled()) {
+        file.cancelWriting();
+        return false;
+    }
+
+    if (!file.commit()) {
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void ExportSession::cancel()
+{
+    dirTree.requestCancel();
+}
+
+bool ExportSession::isRunning() const
+{
+    return worker && worker->isRunning();
+}
+
+bool ExportSession::isCancelled() const
+{
+    return dirTree.isCancelled();
+}
+
+void ExportSession::reportProgress()
+{
+    emit progressChanged(dirTree.getProcessedItems(), dirTree.getTotalItems());
+}
+
+void ExportSession::onWorkerFinished()
+{
+    progressTimer->stop();
+    reportProgress();
+
+    if (dirTree.isCancelled()) {
+        emit cancelled();
+    } else {
+        emit finished(success);
+    }
+}
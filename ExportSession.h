@@ -0,0 +1,62 @@
+#ifndef EXPORTSESSION_H
+#define EXPORTSESSION_H
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <memory>
+#include "DirectoryTree.h"
+
+enum class ExportFormat {
+    TEXT,
+    MARKDOWN,
+    JSON,
+    NDJSON
+};
+
+// 一次导出会话：在工作线程中把已扫描的树流式写入文件，
+// 进度和完成通知通过排队信号送回 GUI 线程，支持中途取消。
+// 写入先进入临时文件，成功后才替换目标文件，取消或失败不会留下半个文件
+class ExportSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ExportSession(QObject *parent = nullptr);
+    ~ExportSession() override;
+
+    // 导出开始前通过它配置渲染选项
+    DirectoryTree &tree() { return dirTree; }
+
+    // tree 必须是完整扫描（或达到内存上限）得到的树；导出期间调用方不得修改它（包括按需读取其中未读取的目录）
+    void start(const std::shared_ptr<ScannedTree> &tree, const QString &filePath, ExportFormat format);
+    void cancel();
+    bool isRunning() const;
+    bool isCancelled() const;
+    QString filePath() const { return targetPath; }
+    ExportFormat format() const { return exportFormat; }
+    // finished(false) 时的错误信息
+    QString errorString() const { return error; }
+
+signals:
+    // total 为 0 表示无法估计进度
+    void progressChanged(int written, int total);
+    void cancelled();
+    void finished(bool success);
+
+private:
+    DirectoryTree dirTree;
+    QThread *worker;
+    QTimer *progressTimer;
+    QString targetPath;
+    ExportFormat exportFormat;
+    bool success;
+    QString error;
+
+    bool writeFile(const ScannedTree &tree);
+    void reportProgress();
+    void onWorkerFinished();
+};
+
+#endif // EXPORTSESSION_H
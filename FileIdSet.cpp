@@ -0,0 +1,17 @@
+#include "FileIdSet.h"
+
+bool FileIdSet::insert(const FileId &id)
+{
+    // 相邻的 inode 落在不同分片，同一目录中的条目分散到各把锁上
+    Shard &shard = shards[(id.inode ^ id.device) % SHARD_COUNT];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.ids.insert(id).second;
+}
+
+void FileIdSet::clear()
+{
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.ids.clear();
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef FILEIDSET_H
+#define FILEIDSET_H
+
+#include <array>
+#include <mutex>
+#include <unordered_set>
+#include "FileSystemBackend.h"
+
+// 可被多个扫描线程同时插入的 (设备, inode) 集合，用于跟随符号链接时识别已经读取过的目录
+// 和重复计入的硬链接。按散列值分成多个分片，每个分片一把锁，线程之间很少互相等待
+class FileIdSet
+{
+public:
+    // 插入 id，返回它此前是否不在集合中
+    bool insert(const FileId &id);
+    void clear();
+
+private:
+    struct Hash {
+        size_t operator()(const FileId &id) const
+        {
+            // inode 在同一设备上通常是连续分配的，乘以奇数常量打散到高位再混入设备号
+            quint64 h = id.inode * 0x9E3779B97F4A7C15ull ^ (id.device + (id.device << 17));
+            return size_t(h ^ (h >> 29));
+        }
+    };
+
+    static constexpr size_t SHARD_COUNT = 64;
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_set<FileId, Hash> ids;
+    };
+
+    std::array<Shard, SHARD_COUNT> shards;
+};
+
+#endif // FILEIDSET_H
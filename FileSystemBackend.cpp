@@ -0,0 +1,392 @@
+#include "FileSystemBackend.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include "IoUringStatx.h"
+#include "ScanProfiler.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#else
+#include <QCryptographicHash>
+#include <cstring>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cstring>
+#include <vector>
+#endif
+
+bool FileSystemBackend::isAvailable(ScannerBackend type)
+{
+    switch (type) {
+        case ScannerBackend::NATIVE:
+#ifdef Q_OS_LINUX
+            return true;
+#else
+            return false;
+#endif
+        case ScannerBackend::QDIR:
+        case ScannerBackend::SYNTHETIC:
+        default:
+            return true;
+    }
+}
+
+std::unique_ptr<FileSystemBackend> FileSystemBackend::create(ScannerBackend type, bool useIoUring,
+                                                             bool followSymlinks)
+{
+#ifdef Q_OS_LINUX
+    if (type == ScannerBackend::NATIVE) {
+        return std::make_unique<LinuxDirentBackend>(useIoUring && IoUringStatx::isSupported(), followSymlinks);
+    }
+#else
+    Q_UNUSED(type);
+    Q_UNUSED(useIoUring);
+#endif
+    return std::make_unique<QDirBackend>(followSymlinks);
+}
+
+QDirBackend::QDirBackend(bool followSymlinks)
+    : FileSystemBackend(followSymlinks)
+{
+}
+
+bool QDirBackend::listDirectory(const QString &path, bool showHidden, bool needMetadata,
+                                QVector<DirEntry> &entries)
+{
+    QDir dir(path);
+    if (!dir.exists()) {
+        return false;
+    }
+
+    // 设置过滤器
+    QDir::Filters filters = QDir::NoDotAndDotDot | QDir::AllEntries;
+    if (!followSymlinks) {
+        filters |= QDir::NoSymLinks;
+    }
+    if (showHidden) {
+        filters |= QDir::Hidden;
+    }
+    dir.setFilter(filters);
+
+    // QDir 在列出时一并取得元数据，两者无法分开计时
+    ProfileScope listScope(ProfilePhase::LIST);
+    const QFileInfoList list = dir.entryInfoList();
+    listScope.setItems(list.size());
+
+    ProfileScope stringsScope(ProfilePhase::STRINGS, list.size());
+    entries.reserve(entries.size() + list.size());
+
+    for (const QFileInfo &fileInfo : list) {
+        // QFileInfo 的类型和元数据本来就取自链接目标，目标不存在的链接跳过
+        bool symlink = fileInfo.isSymLink();
+        if (symlink && !fileInfo.exists()) {
+            continue;
+        }
+
+        DirEntry entry;
+        entry.name = fileInfo.fileName();
+        entry.type = fileInfo.isDir() ? EntryType::DIRECTORY : EntryType::FILE;
+        entry.hidden = fileInfo.isHidden();
+        entry.symlink = symlink;
+        if (needMetadata) {
+            entry.modifiedTime = fileInfo.lastModified().toMSecsSinceEpoch();
+            entry.size = fileInfo.size();
+            entry.allocatedSize = entry.size;  // QFileInfo 不提供占用的块数
+            entry.hasMetadata = true;
+        }
+        entries.append(entry);
+    }
+
+    return true;
+}
+
+bool QDirBackend::directoryModifiedTime(const QString &path, qint64 &modifiedTime, FileId *id)
+{
+    QFileInfo info(path);
+    if (!info.isDir()) {
+        return false;
+    }
+
+    modifiedTime = info.lastModified().toMSecsSinceEpoch();
+    if (id) {
+#ifdef Q_OS_UNIX
+        struct stat st;
+        if (stat(QFile::encodeName(path).constData(), &st) == 0) {
+            id->device = quint64(st.st_dev);
+            id->inode = quint64(st.st_ino);
+        }
+#else
+        // 没有 inode 时以规范路径（解析所有链接后）的散列代替
+        const QByteArray digest = QCryptographicHash::hash(info.canonicalFilePath().toUtf8(),
+                                                           QCryptographicHash::Sha1);
+        memcpy(&id->inode, digest.constData(), sizeof(id->inode));
+#endif
+    }
+    return true;
+}
+
+bool QDirBackend::statEntry(const QString &path, DirEntry &entry)
+{
+    QFileInfo info(path);
+    if (!info.exists() || (!info.isDir() && !info.isFile())) {
+        return false;
+    }
+
+    entry.name = info.fileName();
+    entry.type = info.isDir() ? EntryType::DIRECTORY : EntryType::FILE;
+    entry.hidden = info.isHidden();
+    entry.symlink = info.isSymLink();
+    entry.modifiedTime = info.lastModified().toMSecsSinceEpoch();
+    entry.size = info.size();
+    entry.allocatedSize = entry.size;
+    entry.hasMetadata = true;
+    return true;
+}
+
+#ifdef Q_OS_LINUX
+
+namespace {
+
+// 内核 getdents64 返回的记录格式
+struct LinuxDirent64 {
+    quint64 d_ino;
+    qint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+qint64 toMSecs(const struct timespec &ts)
+{
+    return qint64(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 同步获取单个条目的元数据，用于 io_uring 不可用或未完成的请求
+void statRequest(int dirfd, StatxRequest &request)
+{
+    struct stat st;
+    if (fstatat(dirfd, request.name, &st, request.follow ? 0 : AT_SYMLINK_NOFOLLOW) == 0) {
+        request.mode = st.st_mode;
+        request.modifiedTime = toMSecs(st.st_mtim);
+        request.size = uint64_t(st.st_size);
+        request.blocks = uint64_t(st.st_blocks);
+        request.device = uint64_t(st.st_dev);
+        request.inode = uint64_t(st.st_ino);
+        request.linkCount = uint32_t(st.st_nlink);
+        request.status = 0;
+    }
+}
+
+// 读取阶段暂存的目录项：名称保存在线程本地的名称缓冲区中
+struct PendingEntry {
+    size_t nameOffset;
+    int nameLength;
+    unsigned char type;
+};
+
+}
+
+LinuxDirentBackend::LinuxDirentBackend(bool useIoUring, bool followSymlinks)
+    : FileSystemBackend(followSymlinks), useIoUring(useIoUring)
+{
+}
+
+bool LinuxDirentBackend::listDirectory(const QString &path, bool showHidden, bool needMetadata,
+                                       QVector<DirEntry> &entries)
+{
+    const QByteArray encodedPath = QFile::encodeName(path);
+    int fd = openat(AT_FDCWD, encodedPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    // 每个线程复用同一块读取缓冲区，一次系统调用取回大量目录项
+    thread_local std::vector<char> buffer(64 * 1024);
+    thread_local std::vector<char> names;
+    thread_local std::vector<PendingEntry> pending;
+    names.clear();
+    pending.clear();
+
+    // 第一阶段：读出全部目录项
+    qint64 listStart = ScanProfiler::startTime();
+    while (true) {
+        long bytes = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if (bytes == 0) {
+            break;
+        }
+        // 读取中途出错时与打不开目录一样按失败处理，不返回只读了一部分的列表
+        if (bytes < 0) {
+            close(fd);
+            return false;
+        }
+
+        for (long offset = 0; offset < bytes;) {
+            const LinuxDirent64 *record = reinterpret_cast<const LinuxDirent64 *>(buffer.data() + offset);
+            offset += record->d_reclen;
+
+            const char *name = record->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            if (!showHidden && name[0] == '.') {
+                continue;
+            }
+
+            // 特殊文件（以及不跟随时的符号链接）可以直接根据 d_type 跳过
+            unsigned char type = record->d_type;
+            if (type != DT_DIR && type != DT_REG && type != DT_UNKNOWN && !(type == DT_LNK && followSymlinks)) {
+                continue;
+            }
+
+            int length = int(strlen(name));
+            pending.push_back({names.size(), length, type});
+            names.insert(names.end(), name, name + length + 1);
+        }
+    }
+    if (listStart >= 0) {
+        ScanProfiler::instance().record(ProfilePhase::LIST, listStart, qint64(pending.size()));
+    }
+
+    // 第二阶段：为需要的条目获取元数据。名称缓冲区此后不再增长，指针保持有效
+    thread_local std::vector<StatxRequest> requests;
+    thread_local std::vector<int> requestOwners;
+    requests.clear();
+    requestOwners.clear();
+    for (int i = 0; i < int(pending.size()); ++i) {
+        // 符号链接总要获取目标的元数据才知道它指向目录还是文件
+        if (needMetadata || pending[i].type == DT_UNKNOWN || pending[i].type == DT_LNK) {
+            StatxRequest request;
+            request.name = names.data() + pending[i].nameOffset;
+            request.follow = pending[i].type == DT_LNK;
+            requests.push_back(request);
+            requestOwners.push_back(i);
+        }
+    }
+
+    if (!requests.empty()) {
+        ProfileScope statScope(ProfilePhase::STAT, qint64(requests.size()));
+        IoUringStatx *ring = useIoUring ? IoUringStatx::instance() : nullptr;
+        if (ring) {
+            // 返回 false 时环已等到提交的请求全部完成并停用，名称缓冲区可以安全复用；
+            // 没有结果的请求由下面的同步路径补做
+            ring->statBatch(fd, requests.data(), int(requests.size()));
+        }
+
+        // 同步路径，也用于补做 io_uring 未完成的请求
+        for (StatxRequest &request : requests) {
+            if (request.status == 0) {
+                continue;
+            }
+            statRequest(fd, request);
+        }
+
+        // d_type 未知的条目先按链接本身获取，是符号链接时再获取一次目标
+        if (followSymlinks) {
+            for (StatxRequest &request : requests) {
+                if (request.status == 0 && !request.follow && S_ISLNK(request.mode)) {
+                    request.follow = true;
+                    request.status = -1;
+                    statRequest(fd, request);
+                }
+            }
+        }
+    }
+
+    // 第三阶段：生成结果
+    ProfileScope stringsScope(ProfilePhase::STRINGS, qint64(pending.size()));
+    entries.reserve(entries.size() + int(pending.size()));
+    size_t nextRequest = 0;
+    for (int i = 0; i < int(pending.size()); ++i) {
+        const PendingEntry &item = pending[i];
+        unsigned char type = item.type;
+        const StatxRequest *metadata = nullptr;
+
+        bool symlink = false;
+        if (nextRequest < requestOwners.size() && requestOwners[nextRequest] == i) {
+            metadata = &requests[nextRequest++];
+            symlink = metadata->follow;
+            if (metadata->status != 0) {
+                continue;
+            }
+            if (S_ISDIR(metadata->mode)) {
+                type = DT_DIR;
+            } else if (S_ISREG(metadata->mode)) {
+                type = DT_REG;
+            } else {
+                continue;
+            }
+        }
+
+        DirEntry entry;
+        entry.name = QString::fromUtf8(names.data() + item.nameOffset, item.nameLength);
+        entry.type = (type == DT_DIR) ? EntryType::DIRECTORY : EntryType::FILE;
+        entry.hidden = names[item.nameOffset] == '.';
+        entry.symlink = symlink;
+        if (metadata) {
+            entry.modifiedTime = metadata->modifiedTime;
+            entry.size = qint64(metadata->size);
+            entry.allocatedSize = qint64(metadata->blocks) * 512;
+            entry.id.device = metadata->device;
+            entry.id.inode = metadata->inode;
+            entry.linkCount = metadata->linkCount;
+            entry.hasMetadata = true;
+        }
+        entries.append(entry);
+    }
+
+    close(fd);
+    return true;
+}
+
+bool LinuxDirentBackend::directoryModifiedTime(const QString &path, qint64 &modifiedTime, FileId *id)
+{
+    struct stat st;
+    if (stat(QFile::encodeName(path).constData(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return false;
+    }
+
+    modifiedTime = toMSecs(st.st_mtim);
+    if (id) {
+        id->device = quint64(st.st_dev);
+        id->inode = quint64(st.st_ino);
+    }
+    return true;
+}
+
+bool LinuxDirentBackend::statEntry(const QString &path, DirEntry &entry)
+{
+    const QByteArray encodedPath = QFile::encodeName(path);
+    StatxRequest request;
+    request.name = encodedPath.constData();
+    statRequest(AT_FDCWD, request);
+    if (request.status == 0 && S_ISLNK(request.mode)) {
+        request.follow = true;
+        request.status = -1;
+        statRequest(AT_FDCWD, request);
+    }
+    if (request.status != 0 || !(S_ISDIR(request.mode) || S_ISREG(request.mode))) {
+        return false;
+    }
+
+    entry.name = QFileInfo(path).fileName();
+    entry.type = S_ISDIR(request.mode) ? EntryType::DIRECTORY : EntryType::FILE;
+    entry.hidden = entry.name.startsWith('.');
+    entry.symlink = request.follow;
+    entry.modifiedTime = request.modifiedTime;
+    entry.size = qint64(request.size);
+    entry.allocatedSize = qint64(request.blocks) * 512;
+    entry.id.device = request.device;
+    entry.id.inode = request.inode;
+    entry.linkCount = request.linkCount;
+    entry.hasMetadata = true;
+    return true;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef FILESYSTEMBACKEND_H
+#define FILESYSTEMBACKEND_H
+
+#include <QString>
+#include <QVector>
+#include <memory>
+
+enum class ScannerBackend {
+    QDIR,
+    NATIVE,
+    SYNTHETIC       // 由描述文件生成的内存目录树，用于模拟高延迟的存储（见 SyntheticBackend）
+};
+
+enum class EntryType : quint8 {
+    FILE,
+    DIRECTORY
+};
+
+// 文件在文件系统中的身份：同一设备上的 inode 编号。inode 为 0 表示未知
+struct FileId {
+    quint64 device = 0;
+    quint64 inode = 0;
+
+    bool isValid() const { return inode != 0; }
+    bool operator==(const FileId &other) const { return device == other.device && inode == other.inode; }
+};
+
+// 目录中的一项；元数据只在需要时填充
+struct DirEntry {
+    QString name;
+    EntryType type = EntryType::FILE;
+    bool hidden = false;
+    bool hasMetadata = false;
+    qint64 modifiedTime = 0;  // 毫秒时间戳
+    qint64 size = 0;          // 字节数，目录为 0 或文件系统报告的目录大小
+    qint64 allocatedSize = 0; // 实际占用的磁盘空间（稀疏文件可能小于 size）
+    bool symlink = false;     // 经符号链接到达，类型和元数据都是链接目标的（只在跟随符号链接时出现）
+    bool duplicate = false;   // 同一文件已在树中别处计入（硬链接或指向它的链接），汇总大小时跳过
+    bool archive = false;     // 作为目录浏览的压缩包文件，大小和修改时间是压缩包本身的（见 ArchiveBackend）
+    FileId id;                // 只有原生后端在获取元数据时填充
+    quint32 linkCount = 0;    // 硬链接数，0 表示未知
+
+    bool isDir() const { return type == EntryType::DIRECTORY; }
+};
+
+// 目录扫描后端：只负责列出单个目录，必须可以被多个线程同时调用
+class FileSystemBackend
+{
+public:
+    virtual ~FileSystemBackend() = default;
+
+    // 列出目录内容（不含 . 和 ..，跳过特殊文件；不跟随符号链接时也跳过符号链接，
+    // 跟随时按链接目标列出，目标不存在的链接跳过）。
+    // needMetadata 为 true 时同时获取修改时间和大小。无法打开目录时返回 false
+    virtual bool listDirectory(const QString &path, bool showHidden, bool needMetadata,
+                               QVector<DirEntry> &entries) = 0;
+    // 目录自身的修改时间（毫秒），增删或重命名其中的条目都会改变它。
+    // id 不为空时同时返回目录（跟随链接后）的身份，无法获取时保持无效。失败时返回 false
+    virtual bool directoryModifiedTime(const QString &path, qint64 &modifiedTime, FileId *id = nullptr) = 0;
+    // 获取单个目录或文件的类型和元数据（name 为最后一级名称）。与 stat 一样总是跟随符号链接，
+    // 用于检查用户给出的根目录等路径。不存在的路径和特殊文件返回 false
+    virtual bool statEntry(const QString &path, DirEntry &entry) = 0;
+    // 一次扫描开始和结束时由发起扫描的线程调用。后端可以在两者之间保留扫描中反复用到的状态，结束时释放
+    virtual void beginScan() {}
+    virtual void endScan() {}
+
+    static bool isAvailable(ScannerBackend type);
+    // useIoUring 只对原生后端有效：需要元数据时通过 io_uring 批量提交 statx。
+    // followSymlinks 为 true 时把指向目录和文件的符号链接当作目标本身列出
+    static std::unique_ptr<FileSystemBackend> create(ScannerBackend type, bool useIoUring = false,
+                                                     bool followSymlinks = false);
+
+protected:
+    explicit FileSystemBackend(bool followSymlinks = false) : followSymlinks(followSymlinks) {}
+
+    bool followSymlinks;
+};
+
+// 基于 QDir/QFileInfo 的跨平台后端
+class QDirBackend : public FileSystemBackend
+{
+public:
+    explicit QDirBackend(bool followSymlinks = false);
+
+    bool listDirectory(const QString &path, bool showHidden, bool needMetadata,
+                       QVector<DirEntry> &entries) override;
+    bool directoryModifiedTime(const QString &path, qint64 &modifiedTime, FileId *id = nullptr) override;
+    bool statEntry(const QString &path, DirEntry &entry) override;
+};
+
+#ifdef Q_OS_LINUX
+// Linux 原生后端：用 getdents64 批量读取目录项并直接使用内核返回的 d_type，
+// 只有 d_type 未知或需要元数据时才获取元数据；整个目录的 statx 请求可以经 io_uring 批量提交，
+// io_uring 不可用时回退为逐项 fstatat
+class LinuxDirentBackend : public FileSystemBackend
+{
+public:
+    explicit LinuxDirentBackend(bool useIoUring = false, bool followSymlinks = false);
+    
+    bool listDirectory(const QString &path, bool showHidden, bool needMetadata,
+                       QVector<DirEntry> &entries) override;
+    bool directoryModifiedTime(const QString &path, qint64 &modifiedTime, FileId *id = nullptr) override;
+    bool statEntry(const QString &path, DirEntry &entry) override;
+
+private:
+    bool useIoUring;
+};
+#endif
+
+#endif // FILESYSTEMBACKEND_H
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "IgnoreMatcher.h"
+
+namespace {
+
+bool hasWildcard(const QString &text)
+{
+    for (QChar c : text) {
+        if (c == '*' || c == '?' || c == '[') {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+void IgnoreMatcher::setPatterns(const QStringList &patterns)
+{
+    exactNames.clear();
+    suffixesByLastChar.clear();
+    matchAll = false;
+    prefixes.clear();
+    infixes.clear();
+    hasComplexPatterns = false;
+
+    QStringList complex;
+
+    for (const QString &pattern : patterns) {
+        if (pattern.isEmpty()) {
+            continue;
+        }
+
+        if (!hasWildcard(pattern)) {
+            exactNames.insert(pattern);
+            continue;
+        }
+
+        // 去掉首尾的 * 后如果不再含通配符，就可以用简单的字符串比较
+        bool leadingStar = pattern.startsWith('*');
+        bool trailingStar = pattern.size() > 1 && pattern.endsWith('*');
+        QString core = pattern.mid(leadingStar ? 1 : 0);
+        if (trailingStar) {
+            core.chop(1);
+        }
+
+        if (hasWildcard(core)) {
+            complex << QRegularExpression::wildcardToRegularExpression(pattern);
+        } else if (core.isEmpty()) {
+            matchAll = true;
+        } else if (leadingStar && trailingStar) {
+            infixes.append(core);
+        } else if (leadingStar) {
+            suffixesByLastChar[core.back()].append(core);
+        } else {
+            prefixes.append(core);
+        }
+    }
+
+    if (!complex.isEmpty()) {
+        // 所有复杂模式合并成一个正则，只编译一次
+        complexPatterns.setPattern("(?:" + complex.join(")|(?:") + ")");
+        complexPatterns.optimize();
+        hasComplexPatterns = complexPatterns.isValid();
+    }
+}
+
+bool IgnoreMatcher::isEmpty() const
+{
+    return exactNames.isEmpty() && suffixesByLastChar.isEmpty() && !matchAll
+            && prefixes.isEmpty() && infixes.isEmpty() && !hasComplexPatterns;
+}
+
+bool IgnoreMatcher::matches(const QString &name) const
+{
+    if (matchAll) {
+        return true;
+    }
+
+    if (exactNames.contains(name)) {
+        return true;
+    }
+
+    if (!name.isEmpty() && !suffixesByLastChar.isEmpty()) {
+        auto it = suffixesByLastChar.constFind(name.back());
+        if (it != suffixesByLastChar.constEnd()) {
+            for (const QString &suffix : it.value()) {
+                if (name.endsWith(suffix)) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    for (const QString &prefix : prefixes) {
+        if (name.startsWith(prefix)) {
+            return true;
+        }
+    }
+
+    for (const QString &infix : infixes) {
+        if (name.contains(infix)) {
+            return true;
+        }
+    }
+
+    return hasComplexPatterns && complexPatterns.match(name).hasMatch();
+}
\ No newline at end of file
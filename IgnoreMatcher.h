@@ -0,0 +1,31 @@
+#ifndef IGNOREMATCHER_H
+#define IGNOREMATCHER_H
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// 预编译的忽略模式匹配器。setPatterns 时把模式按形态分类：
+// 精确名称放入哈希集合，"*.ext" 一类后缀模式按末字符分桶，
+// 前缀/包含模式直接做字符串比较，只有真正复杂的通配符才合并成一个优化过的正则
+class IgnoreMatcher
+{
+public:
+    void setPatterns(const QStringList &patterns);
+    bool matches(const QString &name) const;
+    bool isEmpty() const;
+
+private:
+    QSet<QString> exactNames;
+    QHash<QChar, QVector<QString>> suffixesByLastChar;  // "*xyz"
+    bool matchAll = false;                              // "*"
+    QVector<QString> prefixes;                          // "abc*"
+    QVector<QString> infixes;                           // "*abc*"
+    QRegularExpression complexPatterns;                 // 其余模式合并后的正则
+    bool hasComplexPatterns = false;
+};
+
+#endif // IGNOREMATCHER_H
\ No newline at end of file
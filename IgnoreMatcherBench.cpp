@@ -0,0 +1,113 @@
+// 忽略模式匹配的微基准：对比逐项构造正则的旧实现与预编译的 IgnoreMatcher
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QSet>
+#include <QStringList>
+#include <QTextStream>
+#include "IgnoreMatcher.h"
+
+namespace {
+
+// 旧实现：精确名称查集合，其余每个模式每次都重新构造正则
+class LegacyMatcher
+{
+public:
+    explicit LegacyMatcher(const QStringList &patterns) : patterns(patterns)
+    {
+        for (const QString &pattern : patterns) {
+            if (!pattern.contains('*') && !pattern.contains('?')) {
+                exactNames.insert(pattern);
+            }
+        }
+    }
+
+    bool matches(const QString &name) const
+    {
+        if (exactNames.contains(name)) {
+            return true;
+        }
+        for (const QString &pattern : patterns) {
+            QRegularExpression regex(QRegularExpression::wildcardToRegularExpression(pattern));
+            if (regex.match(name).hasMatch()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    QStringList patterns;
+    QSet<QString> exactNames;
+};
+
+QStringList benchmarkPatterns()
+{
+    return {
+        ".git", "node_modules", ".vscode", "__pycache__", ".idea", "build", "dist", "target",
+        ".cache", "vendor", "*.o", "*.obj", "*.tmp", "*.log", "*.pyc", "*.class", "*.swp",
+        "*.bak", "*.a", "*.so", "*.dll", "*.exe", "~*", "#*", "*.orig", "cmake-build-*",
+        "*.egg-info", "*~", "*.d", "test_?.dat", "*.min.[jc]s", "*backup*"
+    };
+}
+
+QStringList benchmarkNames(int count)
+{
+    static const char *stems[] = { "main", "util", "config", "README", "data", "index", "module", "test" };
+    static const char *extensions[] = { ".cpp", ".h", ".txt", ".o", ".log", ".json", ".md", ".min.js", "" };
+
+    QStringList names;
+    names.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        names << QString("%1_%2%3").arg(stems[i % 8]).arg(i).arg(extensions[(i / 8) % 9]);
+        if (i % 97 == 0) {
+            names.last() = "node_modules";
+        }
+    }
+    return names;
+}
+
+template <typename Matcher>
+double nanosecondsPerEntry(const Matcher &matcher, const QStringList &names, int rounds, int &matched)
+{
+    QElapsedTimer timer;
+    timer.start();
+    matched = 0;
+    for (int round = 0; round < rounds; ++round) {
+        for (const QString &name : names) {
+            if (matcher.matches(name)) {
+                ++matched;
+            }
+        }
+    }
+    return double(timer.nsecsElapsed()) / (double(names.size()) * rounds);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const QStringList patterns = benchmarkPatterns();
+    const QStringList names = benchmarkNames(20000);
+
+    LegacyMatcher legacy(patterns);
+    IgnoreMatcher compiled;
+    compiled.setPatterns(patterns);
+
+    int legacyMatched = 0;
+    int compiledMatched = 0;
+    double legacyNs = nanosecondsPerEntry(legacy, names, 1, legacyMatched);
+    double compiledNs = nanosecondsPerEntry(compiled, names, 20, compiledMatched);
+
+    out << "patterns: " << patterns.size() << ", entries: " << names.size() << "\n";
+    out << "legacy shouldIgnore:  " << QString::number(legacyNs, 'f', 1) << " ns/entry ("
+        << legacyMatched << " matched)\n";
+    out << "IgnoreMatcher:        " << QString::number(compiledNs, 'f', 1) << " ns/entry ("
+        << compiledMatched / 20 << " matched)\n";
+    out << "speedup:              " << QString::number(legacyNs / compiledNs, 'f', 1) << "x\n";
+
+    return legacyMatched == compiledMatched / 20 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include "IoUringStatx.h"
+
+#ifdef DTV_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+const unsigned RING_ENTRIES = 256;
+
+int ioUringSetup(unsigned entries, io_uring_params *params)
+{
+    return int(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return int(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, void *arg, unsigned count)
+{
+    return int(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+unsigned loadAcquire(const unsigned *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void storeRelease(unsigned *p, unsigned value)
+{
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+// -1 未探测，0 不支持，1 支持
+std::atomic<int> supportState(-1);
+
+}
+
+IoUringStatx::~IoUringStatx()
+{
+    if (sqes) {
+        munmap(sqes, sqesSize);
+    }
+    if (cqRing && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    if (sqRing) {
+        munmap(sqRing, sqRingSize);
+    }
+    if (ringFd >= 0) {
+        close(ringFd);
+    }
+    free(results);
+}
+
+bool IoUringStatx::isSupported()
+{
+    if (supportState.load(std::memory_order_acquire) < 0) {
+        IoUringStatx probe;
+        supportState.store(probe.setup() ? 1 : 0, std::memory_order_release);
+    }
+    return supportState.load(std::memory_order_acquire) == 1;
+}
+
+IoUringStatx *IoUringStatx::instance()
+{
+    if (!isSupported()) {
+        return nullptr;
+    }
+
+    thread_local std::unique_ptr<IoUringStatx> ring;
+    thread_local bool failed = false;
+    // 出过错的环已收回全部请求，可以安全释放；本线程此后回退到同步 stat
+    if (ring && ring->broken) {
+        ring.reset();
+        failed = true;
+    }
+    if (!ring && !failed) {
+        ring.reset(new IoUringStatx);
+        if (!ring->setup()) {
+            ring.reset();
+            failed = true;
+        }
+    }
+    return ring.get();
+}
+
+bool IoUringStatx::setup()
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ringFd = ioUringSetup(RING_ENTRIES, &params);
+    if (ringFd < 0) {
+        return false;
+    }
+
+    // 确认内核支持 IORING_OP_STATX（5.6 起）
+    const unsigned probeOps = 256;
+    size_t probeSize = sizeof(io_uring_probe) + probeOps * sizeof(io_uring_probe_op);
+    io_uring_probe *probe = static_cast<io_uring_probe *>(calloc(1, probeSize));
+    bool statxSupported = false;
+    if (probe && ioUringRegister(ringFd, IORING_REGISTER_PROBE, probe, probeOps) == 0) {
+        statxSupported = probe->last_op >= IORING_OP_STATX
+                && (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    if (!statxSupported) {
+        return false;
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cqRingSize > sqRingSize) {
+            sqRingSize = cqRingSize;
+        }
+        cqRingSize = sqRingSize;
+    }
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        sqRing = nullptr;
+        return false;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing = sqRing;
+    } else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            cqRing = nullptr;
+            return false;
+        }
+    }
+
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ringFd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        sqes = nullptr;
+        return false;
+    }
+
+    char *sq = static_cast<char *>(sqRing);
+    sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sqEntries = params.sq_entries;
+
+    char *cq = static_cast<char *>(cqRing);
+    cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+
+    results = calloc(sqEntries, sizeof(struct statx));
+    return results != nullptr;
+}
+
+int IoUringStatx::submitAndWait(unsigned toSubmit)
+{
+    int ret;
+    do {
+        ret = ioUringEnter(ringFd, toSubmit, toSubmit, IORING_ENTER_GETEVENTS);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+bool IoUringStatx::statBatch(int dirfd, StatxRequest *requests, int count)
+{
+    io_uring_sqe *sqeArray = static_cast<io_uring_sqe *>(sqes);
+    io_uring_cqe *cqeArray = static_cast<io_uring_cqe *>(cqes);
+    struct statx *buffers = static_cast<struct statx *>(results);
+
+    // 按提交队列容量分批：整批放入队列后一次 io_uring_enter 提交并等待全部完成
+    for (int base = 0; base < count; base += int(sqEntries)) {
+        unsigned batch = unsigned(count - base) < sqEntries ? unsigned(count - base) : sqEntries;
+
+        unsigned tail = *sqTail;
+        for (unsigned i = 0; i < batch; ++i) {
+            unsigned index = (tail + i) & *sqMask;
+            io_uring_sqe *sqe = &sqeArray[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = dirfd;
+            sqe->addr = reinterpret_cast<uint64_t>(requests[base + i].name);
+            sqe->len = STATX_TYPE | STATX_MODE | STATX_MTIME | STATX_SIZE | STATX_BLOCKS | STATX_INO | STATX_NLINK;
+            sqe->off = reinterpret_cast<uint64_t>(&buffers[i]);
+            sqe->statx_flags = requests[base + i].follow ? AT_STATX_SYNC_AS_STAT
+                                                         : AT_SYMLINK_NOFOLLOW | AT_STATX_SYNC_AS_STAT;
+            sqe->user_data = i;
+            sqArray[index] = index;
+        }
+        storeRelease(sqTail, tail + batch);
+
+        // 收割已完成的事件；user_data 是请求在本批中的序号
+        unsigned completed = 0;
+        auto reap = [&]() {
+            unsigned head = *cqHead;
+            unsigned cqTailValue = loadAcquire(cqTail);
+            for (; head != cqTailValue; ++head) {
+                const io_uring_cqe &cqe = cqeArray[head & *cqMask];
+                unsigned i = unsigned(cqe.user_data);
+                StatxRequest &request = requests[base + i];
+                request.status = cqe.res;
+                if (cqe.res == 0) {
+                    request.mode = buffers[i].stx_mode;
+                    request.size = buffers[i].stx_size;
+                    request.blocks = buffers[i].stx_blocks;
+                    // 与 stat 的 st_dev 编码一致，两条路径得到的身份可以互相比较
+                    request.device = makedev(buffers[i].stx_dev_major, buffers[i].stx_dev_minor);
+                    request.inode = buffers[i].stx_ino;
+                    request.linkCount = buffers[i].stx_nlink;
+                    request.modifiedTime = int64_t(buffers[i].stx_mtime.tv_sec) * 1000
+                            + buffers[i].stx_mtime.tv_nsec / 1000000;
+                }
+                ++completed;
+            }
+            storeRelease(cqHead, head);
+        };
+
+        unsigned submitted = 0;
+        while (completed < batch) {
+            int ret;
+            if (submitted < batch) {
+                ret = submitAndWait(batch - submitted);
+                if (ret >= 0) {
+                    submitted += unsigned(ret);
+                }
+            } else {
+                do {
+                    ret = ioUringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+                } while (ret < 0 && errno == EINTR);
+            }
+            if (ret < 0) {
+                // 出错时已被内核取走的请求仍可能在执行，会写入 results 并读取调用方的名称缓冲区：
+                // 收回还没被取走的请求，等已取走的全部完成后再返回，之后这个环不再使用
+                unsigned consumed = loadAcquire(sqHead) - tail;
+                storeRelease(sqTail, tail + consumed);
+                while (completed < consumed) {
+                    reap();
+                    if (completed < consumed && ioUringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0
+                            && errno != EINTR) {
+                        sched_yield();
+                    }
+                }
+                broken = true;
+                return false;
+            }
+            reap();
+        }
+    }
+
+    return true;
+}
+
+#else
+
+IoUringStatx::~IoUringStatx() = default;
+
+bool IoUringStatx::isSupported()
+{
+    return false;
+}
+
+IoUringStatx *IoUringStatx::instance()
+{
+    return nullptr;
+}
+
+bool IoUringStatx::setup()
+{
+    return false;
+}
+
+int IoUringStatx::submitAndWait(unsigned)
+{
+    return -1;
+}
+
+bool IoUringStatx::statBatch(int, StatxRequest *, int)
+{
+    return false;
+}
+
+#endif
\ No newline at end of file
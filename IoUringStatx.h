@@ -0,0 +1,69 @@
+#ifndef IOURINGSTATX_H
+#define IOURINGSTATX_H
+
+#include <cstdint>
+
+// 一个 statx 请求：name 相对于批量调用时给出的目录描述符
+struct StatxRequest {
+    const char *name = nullptr;
+    bool follow = false;       // 跟随符号链接，返回链接目标的元数据
+    uint32_t mode = 0;         // st_mode
+    int64_t modifiedTime = 0;  // 毫秒时间戳
+    uint64_t size = 0;         // st_size
+    uint64_t blocks = 0;       // st_blocks，以 512 字节为单位
+    uint64_t device = 0;       // st_dev
+    uint64_t inode = 0;        // st_ino
+    uint32_t linkCount = 0;    // st_nlink
+    int status = -1;           // 0 表示成功，否则为负的 errno
+};
+
+// 基于 io_uring 的批量 statx：一次把整个目录的请求放入提交队列，
+// 由内核并发执行后统一收割完成事件，从而把逐个 stat 的延迟隐藏在队列深度之后。
+// 每个线程拥有独立的环；内核不支持时 instance() 返回 nullptr，调用方应回退到同步 stat
+class IoUringStatx
+{
+public:
+    ~IoUringStatx();
+
+    IoUringStatx(const IoUringStatx &) = delete;
+    IoUringStatx &operator=(const IoUringStatx &) = delete;
+
+    // 当前线程的实例，不可用时返回 nullptr
+    static IoUringStatx *instance();
+    static bool isSupported();
+
+    // 对 dirfd 下的一批条目执行 statx。返回 false 表示环出现错误且已不可用：返回前已等待所有
+    // 提交给内核的请求完成（不再访问 requests 中的名称），未完成的请求保持 status < 0，
+    // 调用方应自行补做同步 stat；本线程之后的 instance() 返回 nullptr
+    bool statBatch(int dirfd, StatxRequest *requests, int count);
+
+private:
+    IoUringStatx() = default;
+    bool setup();
+    int submitAndWait(unsigned toSubmit);
+
+    int ringFd = -1;
+    bool broken = false;    // 出错后不再使用
+    void *sqRing = nullptr;
+    void *cqRing = nullptr;
+    void *sqes = nullptr;
+    unsigned long sqRingSize = 0;
+    unsigned long cqRingSize = 0;
+    unsigned long sqesSize = 0;
+
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqArray = nullptr;
+    unsigned sqEntries = 0;
+
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    void *cqes = nullptr;
+
+    // statx 结果缓冲区，与提交队列等长
+    void *results = nullptr;
+};
+
+#endif // IOURINGSTATX_H
\ No newline at end of file
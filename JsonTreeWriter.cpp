@@ -0,0 +1,194 @@
+#include "JsonTreeWriter.h"
+
+namespace {
+
+const int FLUSH_THRESHOLD = 256 * 1024;
+
+char hexDigit(uint value)
+{
+    return char(value < 10 ? '0' + value : 'a' + value - 10);
+}
+
+}
+
+JsonTreeWriter::JsonTreeWriter(QIODevice *device)
+    : device(device)
+{
+    buffer.reserve(FLUSH_THRESHOLD + 4096);
+}
+
+void JsonTreeWriter::setProgress(std::atomic<int> *written, const std::atomic<bool> *cancelled)
+{
+    this->written = written;
+    this->cancelled = cancelled;
+}
+
+bool JsonTreeWriter::flush()
+{
+    if (buffer.isEmpty()) {
+        return true;
+    }
+
+    if (device->write(buffer) != buffer.size()) {
+        error = device->errorString();
+        return false;
+    }
+    buffer.clear();
+    return true;
+}
+
+bool JsonTreeWriter::nodeWritten()
+{
+    if (written) {
+        written->fetch_add(1, std::memory_order_relaxed);
+    }
+    if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+        return false;
+    }
+    return buffer.size() < FLUSH_THRESHOLD || flush();
+}
+
+void JsonTreeWriter::appendIndent(int level)
+{
+    buffer.append(4 * level, ' ');
+}
+
+void JsonTreeWriter::appendString(const char *data, int length)
+{
+    // 与 QJsonDocument 相同的转义规则：非 ASCII 字符按 UTF-8 原样输出
+    buffer += '"';
+    for (int i = 0; i < length; ++i) {
+        uchar c = uchar(data[i]);
+        switch (c) {
+            case '"':  buffer += "\\\""; break;
+            case '\\': buffer += "\\\\"; break;
+            case '\b': buffer += "\\b"; break;
+            case '\f': buffer += "\\f"; break;
+            case '\n': buffer += "\\n"; break;
+            case '\r': buffer += "\\r"; break;
+            case '\t': buffer += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    buffer += "\\u00";
+                    buffer += hexDigit(c >> 4);
+                    buffer += hexDigit(c & 0xf);
+                } else {
+                    buffer += char(c);
+                }
+                break;
+        }
+    }
+    buffer += '"';
+}
+
+void JsonTreeWriter::pushPath(const NodeStore &nodes, NodeId node)
+{
+    if (!path.endsWith('/')) {
+        path += '/';
+    }
+    path.append(nodes.nameData(node), nodes.nameLength(node));
+}
+
+bool JsonTreeWriter::writeJson(const ScannedTree &tree)
+{
+    error.clear();
+    buffer.clear();
+    path = tree.rootPath.toUtf8();
+
+    if (!writeItem(tree.nodes, tree.root, 0, 0)) {
+        return false;
+    }
+    buffer += '\n';
+    return flush();
+}
+
+// 一个 JSON 对象，键按 QJsonObject 的顺序（字母序）输出：children、name、path、type
+bool JsonTreeWriter::writeItem(const NodeStore &nodes, NodeId node, int level, int depth)
+{
+    bool isDir = nodes.isDir(node);
+    buffer += "{\n";
+
+    if (isDir && (maxDepth <= 0 || depth < maxDepth)) {
+        appendIndent(level + 1);
+        buffer += "\"children\": [\n";
+
+        int count = nodes.childCount(node);
+        for (int i = 0; i < count; ++i) {
+            NodeId child = nodes.child(node, i);
+            int parentLength = path.size();
+            pushPath(nodes, child);
+
+            appendIndent(level + 2);
+            if (!writeItem(nodes, child, level + 2, depth + 1)) {
+                return false;
+            }
+            buffer += i < count - 1 ? ",\n" : "\n";
+
+            path.truncate(parentLength);
+        }
+
+        appendIndent(level + 1);
+        buffer += "],\n";
+    }
+
+    appendIndent(level + 1);
+    buffer += "\"name\": ";
+    appendString(nodes.nameData(node), nodes.nameLength(node));
+    buffer += ",\n";
+
+    appendIndent(level + 1);
+    buffer += "\"path\": ";
+    appendString(path.constData(), path.size());
+    buffer += ",\n";
+
+    appendIndent(level + 1);
+    buffer += isDir ? "\"type\": \"directory\"\n" : "\"type\": \"file\"\n";
+
+    appendIndent(level);
+    buffer += '}';
+    return nodeWritten();
+}
+
+bool JsonTreeWriter::writeNdjson(const ScannedTree &tree)
+{
+    error.clear();
+    buffer.clear();
+    path = tree.rootPath.toUtf8();
+
+    if (!writeNdjsonItem(tree.nodes, tree.root, 0)) {
+        return false;
+    }
+    return flush();
+}
+
+// 先序输出，每行一个节点：{"name":...,"path":...,"type":...,"depth":N}
+bool JsonTreeWriter::writeNdjsonItem(const NodeStore &nodes, NodeId node, int depth)
+{
+    bool isDir = nodes.isDir(node);
+
+    buffer += "{\"name\":";
+    appendString(nodes.nameData(node), nodes.nameLength(node));
+    buffer += ",\"path\":";
+    appendString(path.constData(), path.size());
+    buffer += isDir ? ",\"type\":\"directory\",\"depth\":" : ",\"type\":\"file\",\"depth\":";
+    buffer += QByteArray::number(depth);
+    buffer += "}\n";
+
+    if (!nodeWritten()) {
+        return false;
+    }
+
+    int count = nodes.childCount(node);
+    for (int i = 0; i < count; ++i) {
+        NodeId child = nodes.child(node, i);
+        int parentLength = path.size();
+        pushPath(nodes, child);
+
+        if (!writeNdjsonItem(nodes, child, depth + 1)) {
+            return false;
+        }
+
+        path.truncate(parentLength);
+    }
+    return true;
+}
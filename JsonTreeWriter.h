@@ -0,0 +1,46 @@
+#ifndef JSONTREEWRITER_H
+#define JSONTREEWRITER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <atomic>
+#include "DirectoryTree.h"
+
+// 边遍历边写出 JSON 的写入器，不构造 QJsonObject / QJsonDocument。
+// writeJson 的输出与 QJsonDocument::toJson(Indented) 逐字节一致；
+// writeNdjson 每行输出一个节点，便于下游工具逐行处理。
+// 输出先积累在缓冲区中，满了再整块写入设备
+class JsonTreeWriter
+{
+public:
+    explicit JsonTreeWriter(QIODevice *device);
+
+    // 与 DirectoryTree::setMaxDepth 的含义相同，决定哪些目录带有 children
+    void setMaxDepth(int depth) { maxDepth = depth; }
+    // 每写出一个节点加一；cancelled 被置位时尽快停止
+    void setProgress(std::atomic<int> *written, const std::atomic<bool> *cancelled);
+
+    bool writeJson(const ScannedTree &tree);
+    bool writeNdjson(const ScannedTree &tree);
+    QString errorString() const { return error; }
+
+private:
+    QIODevice *device;
+    int maxDepth = -1;
+    std::atomic<int> *written = nullptr;
+    const std::atomic<bool> *cancelled = nullptr;
+    QByteArray buffer;
+    QByteArray path;    // 当前节点的 UTF-8 路径，进入子节点时追加、返回时截断
+    QString error;
+
+    bool writeItem(const NodeStore &nodes, NodeId node, int level, int depth);
+    bool writeNdjsonItem(const NodeStore &nodes, NodeId node, int depth);
+    bool nodeWritten();
+    bool flush();
+    void appendIndent(int level);
+    void appendString(const char *data, int length);
+    void pushPath(const NodeStore &nodes, NodeId node);
+};
+
+#endif // JSONTREEWRITER_H
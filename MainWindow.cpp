@@ -1,19 +1,56 @@
 #include "MainWindow.h"
+#include "ArchiveIndex.h"
 #include "OptionsDialog.h"
+#include "ScanProfiler.h"
 #include <QClipboard>
 #include <QApplication>
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QStyle>
 #include <QStandardPaths>
-#include <QJsonDocument>
-#include <QFile>
 #include <QTimer>
 #include <QHeaderView>
 #include <QDragLeaveEvent>
 #include <QDragMoveEvent>
 #include <QInputDialog>
 #include <QDialog>
+#include <QStatusBar>
+#include <QLocale>
+#include <QSaveFile>
+
+namespace {
+
+// 毫秒数格式化为 mm:ss 或 h:mm:ss
+QString formatDuration(qint64 ms)
+{
+    qint64 seconds = ms / 1000;
+    QString result = QString("%1:%2").arg(seconds / 60 % 60, 2, 10, QChar('0')).arg(seconds % 60, 2, 10, QChar('0'));
+    if (seconds >= 3600) {
+        result.prepend(QString::number(seconds / 3600) + ":");
+    }
+    return result;
+}
+
+// 扫描进度摘要，显示在状态栏中
+QString progressSummary(const ScanProgress &progress)
+{
+    QLocale locale;
+    QString summary = QString("已列出 %1 项，目录 %2/%3，%4 项/秒")
+            .arg(locale.toString(progress.entriesSeen))
+            .arg(locale.toString(progress.dirsCompleted))
+            .arg(locale.toString(progress.dirsDiscovered))
+            .arg(locale.toString(qRound64(progress.entriesPerSecond)));
+    if (progress.bytesStatted > 0) {
+        summary += "，" + locale.formattedDataSize(progress.bytesStatted);
+    }
+    summary += "，已用 " + formatDuration(progress.elapsedMs);
+    if (progress.remainingMs >= 0) {
+        summary += "，剩余约 " + formatDuration(progress.remainingMs);
+    }
+    return summary;
+}
+
+}
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), 
     currentFormat(OutputFormat::TEXT), isHierarchicalView(false), lastExportPath("")
@@ -56,7 +93,17 @@ void MainWindow::setupUI()
     progressBar->setTextVisible(true);
     progressBar->setFormat("扫描中 %p% (%v/%m)");
     progressBar->setVisible(false);
-    mainLayout->addWidget(progressBar);
+    
+    // 取消按钮，与进度条同时显示
+    cancelButton = new QPushButton("取消", this);
+    cancelButton->setIcon(style()->standardIcon(QStyle::SP_DialogCancelButton));
+    cancelButton->setVisible(false);
+    connect(cancelButton, &QPushButton::clicked, this, &MainWindow::cancelScan);
+    
+    QHBoxLayout *progressLayout = new QHBoxLayout();
+    progressLayout->addWidget(progressBar, 1);
+    progressLayout->addWidget(cancelButton);
+    mainLayout->addLayout(progressLayout);
     
     // 创建工具栏
     toolBar = new QToolBar(this);
@@ -69,6 +116,20 @@ void MainWindow::setupUI()
     connect(toggleViewButton, &QPushButton::clicked, this, &MainWindow::toggleView);
     toolBar->addWidget(toggleViewButton);
     
+    // 刷新按钮：丢弃缓存的树并重新扫描磁盘
+    refreshButton = new QPushButton("刷新", this);
+    refreshButton->setIcon(style()->standardIcon(QStyle::SP_BrowserReload));
+    connect(refreshButton, &QPushButton::clicked, this, &MainWindow::refreshTree);
+    toolBar->addWidget(refreshButton);
+    
+    // 实时更新：监视已扫描的目录，变化直接应用到当前显示的树上
+    watchButton = new QPushButton("实时更新", this);
+    watchButton->setCheckable(true);
+    watchButton->setToolTip("监视目录的变化并自动更新，无需重新扫描");
+    watchButton->setEnabled(TreeWatcher::isSupported());
+    connect(watchButton, &QPushButton::toggled, this, &MainWindow::setWatchChanges);
+    toolBar->addWidget(watchButton);
+    
     toolBar->addSeparator();
     
     // 书签按钮
@@ -104,6 +165,10 @@ void MainWindow::setupUI()
     exportMenu->addAction("导出为文本文件(.txt)", this, [this]() { exportToFile(); });
     exportMenu->addAction("导出为Markdown文件(.md)", this, [this]() { exportToFile(); });
     exportMenu->addAction("导出为JSON文件(.json)", this, [this]() { exportToFile(); });
+    exportMenu->addAction("导出为NDJSON文件(.ndjson)", this, [this]() { exportToFile(); });
+    exportMenu->addSeparator();
+    exportMenu->addAction("查看性能分析摘要...", this, &MainWindow::showProfileSummary);
+    exportMenu->addAction("导出性能跟踪(Chrome/Perfetto .json)...", this, &MainWindow::exportProfileTrace);
     
     exportButton->setMenu(exportMenu);
     toolBar->addWidget(exportButton);
@@ -116,31 +181,44 @@ void MainWindow::setupUI()
     
     mainLayout->addWidget(toolBar);
     
-    // 创建文本编辑区
-    treeTextEdit = new QTextEdit(this);
-    treeTextEdit->setReadOnly(true);
-    treeTextEdit->setFont(QFont("Consolas", 10));
-    treeTextEdit->setStyleSheet("QTextEdit { border: 1px solid #ccc; border-radius: 3px; }");
-    treeTextEdit->setPlaceholderText("这里将显示生成的目录树");
-    mainLayout->addWidget(treeTextEdit, 1);
+    // 创建文本显示区，只绘制可见的行
+    treeTextView = new TreeTextView(this);
+    treeTextView->setFont(QFont("Consolas", 10));
+    treeTextView->setStyleSheet("TreeTextView { border: 1px solid #ccc; border-radius: 3px; }");
+    treeTextView->setPlaceholderText("这里将显示生成的目录树");
+    mainLayout->addWidget(treeTextView, 1);
     
     // 创建树形视图
     treeView = new QTreeView(this);
     treeView->setAlternatingRowColors(true);
     treeView->setAnimated(true);
     treeView->setHeaderHidden(false);
-    treeView->setSortingEnabled(true);
+    treeView->setUniformRowHeights(true);
     treeView->setVisible(false);
     
-    treeModel = new QStandardItemModel(this);
-    QStringList headers;
-    headers << "名称" << "类型" << "大小";
-    treeModel->setHorizontalHeaderLabels(headers);
+    // 子项顺序由排序选项决定，模型按需读取目录
+    treeModel = new DirectoryTreeModel(this);
+    treeModel->setIcons(style()->standardIcon(QStyle::SP_DirIcon), style()->standardIcon(QStyle::SP_FileIcon));
     treeView->setModel(treeModel);
     treeView->header()->setSectionResizeMode(0, QHeaderView::Stretch);
     
     mainLayout->addWidget(treeView, 1);
     
+    // 导出在后台进行，进度显示在状态栏中
+    exportProgressBar = new QProgressBar(this);
+    exportProgressBar->setMaximumWidth(200);
+    exportProgressBar->setTextVisible(true);
+    exportProgressBar->setVisible(false);
+    exportCancelButton = new QPushButton("取消导出", this);
+    exportCancelButton->setVisible(false);
+    connect(exportCancelButton, &QPushButton::clicked, this, &MainWindow::cancelExport);
+    memoryLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(memoryLabel);
+    statusBar()->addPermanentWidget(exportProgressBar);
+    statusBar()->addPermanentWidget(exportCancelButton);
+    
+    setupWatcher();
+    
     // 设置接受拖放
     setAcceptDrops(true);
 }
@@ -218,18 +296,37 @@ void MainWindow::copyToClipboard()
         return;
     }
     
-    if (treeTextEdit->toPlainText().isEmpty()) {
+    if (!currentTree || treeTextView->isEmpty()) {
         QMessageBox::information(this, "提示", "没有内容可复制");
         return;
     }
     
-    QApplication::clipboard()->setText(treeTextEdit->toPlainText());
+    // 整棵树要渲染成一个字符串，剪贴板还会再复制一份；放不进内存上限时建议改用流式导出
+    qint64 estimatedBytes = qint64(currentTree->nodes.size()) * 2 * 2 * 64;
+    if (memoryBudget > 0 && estimatedBytes > memoryBudget - qint64(displayedMemory() + treeCache.memoryUsage())) {
+        QMessageBox::information(this, "提示", QString("目录树太大，复制到剪贴板约需 %1 内存，超过了内存上限，请使用导出")
+                                 .arg(QLocale().formattedDataSize(estimatedBytes)));
+        return;
+    }
+    
+    configureTree(dirTree);
+    QApplication::clipboard()->setText(dirTree.renderTree(*currentTree));
     QMessageBox::information(this, "成功", "目录树已复制到剪贴板");
 }
 
 void MainWindow::showOptionsDialog()
 {
     OptionsDialog dialog(indentChars, maxDepth, showFiles, showHidden, this);
+    dialog.setThreadCount(threadCount);
+    dialog.setScannerBackend(scannerBackend);
+    dialog.setUseIoUring(useIoUring);
+    dialog.setUsePersistentCache(usePersistentCache);
+    dialog.setSizeMode(sizeMode);
+    dialog.setFollowSymlinks(followSymlinks);
+    dialog.setOneFileSystem(oneFileSystem);
+    dialog.setBrowseArchives(browseArchives);
+    dialog.setProfileScans(profileScans);
+    dialog.setMemoryBudget(memoryBudget);
     if (dialog.exec() == QDialog::Accepted) {
         indentChars = dialog.getIndentChars();
         maxDepth = dialog.getMaxDepth();
@@ -238,6 +335,17 @@ void MainWindow::showOptionsDialog()
         ignorePatterns = dialog.getIgnorePatterns();
         sortType = dialog.getSortType();
         currentFormat = dialog.getOutputFormat();
+        threadCount = dialog.getThreadCount();
+        scannerBackend = dialog.getScannerBackend();
+        useIoUring = dialog.getUseIoUring();
+        usePersistentCache = dialog.getUsePersistentCache();
+        sizeMode = dialog.getSizeMode();
+        followSymlinks = dialog.getFollowSymlinks();
+        oneFileSystem = dialog.getOneFileSystem();
+        browseArchives = dialog.getBrowseArchives();
+        profileScans = dialog.getProfileScans();
+        memoryBudget = dialog.getMemoryBudget();
+        ScanProfiler::instance().setEnabled(profileScans);
         
         formatComboBox->setCurrentIndex(static_cast<int>(currentFormat));
         
@@ -255,159 +363,409 @@ void MainWindow::generateTree(const QString &path)
     // 更新历史记录
     updateHistory(path);
     
-    // 配置DirectoryTree
-    dirTree.setIndentChars(indentChars);
-    dirTree.setMaxDepth(maxDepth);
-    dirTree.setShowFiles(showFiles);
-    dirTree.setShowHidden(showHidden);
-    dirTree.setIgnorePatterns(ignorePatterns);
-    dirTree.setSortType(sortType);
-    dirTree.setOutputFormat(currentFormat);
+    // 更新目录树
+    updateDirectoryTree();
+}
+
+void MainWindow::configureTree(DirectoryTree &tree) const
+{
+    tree.setIndentChars(indentChars);
+    tree.setMaxDepth(maxDepth);
+    tree.setShowFiles(showFiles);
+    tree.setShowHidden(showHidden);
+    tree.setIgnorePatterns(ignorePatterns);
+    tree.setSortType(sortType);
+    tree.setSizeMode(sizeMode);
+    tree.setOutputFormat(currentFormat);
+    tree.setThreadCount(threadCount);
+    tree.setScannerBackend(scannerBackend);
+    tree.setUseIoUring(useIoUring);
+    tree.setFollowSymlinks(followSymlinks);
+    tree.setOneFileSystem(oneFileSystem);
+    tree.setBrowseArchives(browseArchives);
+}
+
+void MainWindow::updateDirectoryTree()
+{
+    configureTree(dirTree);
     
-    // 开始扫描目录
-    updateProgressBar(true, 0);
+    // 只是切换了视图时继续使用当前的树，保留按需展开和实时更新的内容
+    if (currentTree && currentTree->rootPath == currentPath && currentTree->scanKey == dirTree.scanKey(currentPath)
+        && (currentTree->complete || shallowScan())) {
+        stopScanSession();
+        showCurrentTree();
+        return;
+    }
+    
+    // 缓存的超集树包含新选项需要的全部目录时，只在内存中重新投影，不再访问磁盘
+    std::shared_ptr<ScannedTree> source = treeCache.find(currentPath);
+    if (source && dirTree.covers(*source) && (source->complete || shallowScan())) {
+        stopScanSession();
+        currentTree = dirTree.project(*source);
+        showCurrentTree();
+        return;
+    }
+    
+    startScan(shallowScan());
+}
+
+void MainWindow::refreshTree()
+{
+    if (currentPath.isEmpty()) {
+        return;
+    }
+    
+    // 显式刷新总是完整地重新扫描
+    treeCache.remove(currentPath);
+    scanCache.remove(currentPath);
+    startScan(shallowScan());
+}
+
+void MainWindow::startScan(bool shallow)
+{
+    // 新的扫描开始前放弃上一次尚未完成的扫描
+    stopScanSession();
+    if (profileScans) {
+        ScanProfiler::instance().reset();
+    }
+    
+    // 在后台线程中扫描，界面保持响应
+    scanSession = new ScanSession(this);
+    configureTree(scanSession->tree());
+    
+    // 压缩包的目录结构缓存最多使用内存上限的八分之一（不限时也不限制它）
+    ArchiveCache::instance().setMemoryBudget(size_t(memoryBudget / 8));
+    
+    // 为新的扫描腾出内存：缓存的树按最久未使用的顺序淘汰，至少留出一半给扫描
+    if (memoryBudget > 0) {
+        qint64 displayed = qint64(displayedMemory());
+        treeCache.trim(size_t(qMax<qint64>(0, memoryBudget / 2 - displayed)));
+        qint64 available = memoryBudget - displayed - qint64(treeCache.memoryUsage());
+        scanSession->tree().setMemoryBudget(qMax(available, memoryBudget / 4));
+    }
+    if (usePersistentCache) {
+        scanSession->setSnapshotCache(scanCache);
+    }
     
-    // 使用计时器进行进度更新
-    QTimer *timer = new QTimer(this);
-    connect(timer, &QTimer::timeout, this, [this, timer]() {
-        int total = dirTree.getTotalItems();
-        int processed = dirTree.getProcessedItems();
+    connect(scanSession, &ScanSession::progressChanged, this, [this](const ScanProgress &progress) {
+        statusBar()->showMessage(progressSummary(progress));
+        updateMemoryStatus(progress.memoryBytes);
         
-        if (total > 0) {
-            int percent = (processed * 100) / total;
-            updateProgressBar(true, percent);
-            progressBar->setFormat(QString("扫描中 %1% (%2/%3)").arg(percent).arg(processed).arg(total));
+        // 还无法估计总量时显示为忙碌状态
+        if (progress.percent < 0) {
+            progressBar->setRange(0, 0);
+            return;
         }
+        progressBar->setRange(0, 100);
+        updateProgressBar(true, progress.percent);
+        progressBar->setFormat(QString("扫描中 %p%，剩余约 %1").arg(formatDuration(progress.remainingMs)));
+    });
+    connect(scanSession, &ScanSession::finished, this, [this]() {
+        currentTree = scanSession->result();
+        std::shared_ptr<ScannedTree> source = scanSession->source();
+        qint64 elapsedMs = scanSession->progress().elapsedMs;
+        bool restored = scanSession->restoredFromSnapshot();
+        qint64 relisted = scanSession->relistedDirectories();
+        stopScanSession();
         
-        if (processed >= total && total > 0) {
-            timer->stop();
-            timer->deleteLater();
-            updateProgressBar(false);
-            
-            // 显示完成消息
-            QMessageBox::information(this, "完成", QString("目录树生成完成，扫描了 %1 个项目").arg(processed));
+        if (currentTree) {
+            treeCache.insert(source);
+            showCurrentTree();
+            enforceMemoryBudget();
+            if (restored) {
+                statusBar()->showMessage(QString("已从磁盘缓存恢复目录树，重新读取了 %1 个有变化的目录，用时 %2")
+                                         .arg(QLocale().toString(relisted))
+                                         .arg(formatDuration(elapsedMs)));
+            } else {
+                statusBar()->showMessage(QString("目录树生成完成，扫描了 %1 个项目，用时 %2")
+                                         .arg(QLocale().toString(currentTree->scannedItems))
+                                         .arg(formatDuration(elapsedMs)));
+            }
+            if (currentTree->memoryLimited) {
+                statusBar()->showMessage(QString("已达到内存上限（%1），部分目录只统计了大小，其中的条目可在层级视图中展开")
+                                         .arg(QLocale().formattedDataSize(memoryBudget)));
+            }
+            if (profileScans) {
+                statusBar()->showMessage(statusBar()->currentMessage() + "  |  " + ScanProfiler::instance().shortSummary());
+            }
         }
     });
+    connect(scanSession, &ScanSession::cancelled, this, [this]() {
+        stopScanSession();
+        statusBar()->showMessage("扫描已取消");
+    });
     
-    timer->start(100); // 每100毫秒更新一次
+    progressBar->setRange(0, 0);
+    updateProgressBar(true, 0);
+    progressBar->setFormat("扫描中...");
+    cancelButton->setVisible(true);
     
-    // 更新目录树
-    updateDirectoryTree();
+    scanSession->start(currentPath, shallow);
 }
 
-void MainWindow::updateDirectoryTree()
+void MainWindow::showCurrentTree()
 {
-    if (isHierarchicalView) {
-        // 层级视图模式
-        treeTextEdit->setVisible(false);
-        treeView->setVisible(true);
-        
-        QJsonObject jsonTree = dirTree.generateJsonTree(currentPath);
-        createTreeViewModel(jsonTree);
-    } else {
-        // 文本视图模式
-        treeTextEdit->setVisible(true);
-        treeView->setVisible(false);
-        
-        QString result = dirTree.generateTree(currentPath);
-        treeTextEdit->setText(result);
+    treeTextView->setVisible(!isHierarchicalView);
+    treeView->setVisible(isHierarchicalView);
+    
+    if (!currentTree) {
+        return;
     }
+    
+    // 渲染只依赖内存中的树
+    configureTree(dirTree);
+    {
+        ProfileScope viewScope(ProfilePhase::VIEW, currentTree->nodes.size());
+        if (isHierarchicalView) {
+            createTreeViewModel(currentTree);
+        } else {
+            treeTextView->setTree(currentTree, &dirTree);
+        }
+    }
+    updateWatcher();
+    updateMemoryStatus();
 }
 
-void MainWindow::createTreeViewModel(const QJsonObject &jsonTree)
+void MainWindow::setupWatcher()
 {
-    treeModel->clear();
-    
-    QStringList headers;
-    headers << "名称" << "类型" << "路径";
-    treeModel->setHorizontalHeaderLabels(headers);
+    treeWatcher = new TreeWatcher(this);
     
-    // 添加根节点
-    QStandardItem *rootItem = new QStandardItem(jsonTree["name"].toString());
-    rootItem->setIcon(style()->standardIcon(QStyle::SP_DirIcon));
-    treeModel->appendRow(rootItem);
+    // 模型和文本视图可能还持有之前的树，只转发给显示被监视的树的那一方
+    connect(treeWatcher, &TreeWatcher::directoryAboutToChange, this, [this](NodeId dir) {
+        std::shared_ptr<ScannedTree> tree = treeWatcher->watchedTree();
+        if (treeModel->currentTree() == tree) {
+            treeModel->beginDirectoryChange(dir);
+        }
+        if (treeTextView->currentTree() == tree) {
+            treeTextView->beginDirectoryChange(dir);
+        }
+    });
+    connect(treeWatcher, &TreeWatcher::directoryChanged, this, [this](NodeId dir, NodeId oldFirstChild, int oldCount) {
+        std::shared_ptr<ScannedTree> tree = treeWatcher->watchedTree();
+        if (treeModel->currentTree() == tree) {
+            treeModel->endDirectoryChange(dir, oldFirstChild, oldCount);
+        }
+        if (treeTextView->currentTree() == tree) {
+            treeTextView->endDirectoryChange(dir);
+        }
+    });
+    connect(treeWatcher, &TreeWatcher::treeAboutToBeCompacted, this, [this]() {
+        if (treeModel->currentTree() == treeWatcher->watchedTree()) {
+            treeModel->beginCompaction();
+        }
+    });
+    connect(treeWatcher, &TreeWatcher::treeCompacted, this, [this](const std::vector<NodeId> &oldToNew) {
+        std::shared_ptr<ScannedTree> tree = treeWatcher->watchedTree();
+        if (treeModel->currentTree() == tree) {
+            treeModel->endCompaction(oldToNew);
+        }
+        if (treeTextView->currentTree() == tree) {
+            treeTextView->remapNodes(oldToNew);
+        }
+    });
+    connect(treeWatcher, &TreeWatcher::changesApplied, this, [this](int directories) {
+        // 超集树已经过时，之后修改选项时重新验证磁盘
+        treeCache.remove(treeWatcher->watchedTree()->rootPath);
+        updateMemoryStatus();
+        statusBar()->showMessage(QString("已更新 %1 个有变化的目录").arg(directories), 3000);
+    });
+    connect(treeWatcher, &TreeWatcher::watchLimitReached, this, [this]() {
+        statusBar()->showMessage("已达到系统的目录监视数量上限（fs.inotify.max_user_watches），其余目录的变化需要手动刷新");
+    });
+    connect(treeWatcher, &TreeWatcher::resyncRequired, this, [this]() {
+        // 丢失了部分事件，按目录修改时间重新验证（有磁盘快照时无需完整扫描）
+        if (!currentPath.isEmpty() && !scanSession) {
+            treeCache.remove(currentPath);
+            startScan(shallowScan());
+        }
+    });
     
-    // 添加子节点
-    QJsonArray children = jsonTree["children"].toArray();
-    for (const QJsonValue &child : children) {
-        QJsonObject childObj = child.toObject();
-        
-        QStandardItem *nameItem = new QStandardItem(childObj["name"].toString());
-        QStandardItem *typeItem = new QStandardItem();
-        QStandardItem *pathItem = new QStandardItem();
-        
-        QString type = childObj["type"].toString();
-        if (type == "directory") {
-            nameItem->setIcon(style()->standardIcon(QStyle::SP_DirIcon));
-            typeItem->setText("文件夹");
-            
-            // 递归添加子目录
-            QJsonArray subChildren = childObj["children"].toArray();
-            for (const QJsonValue &subChild : subChildren) {
-                addTreeItem(nameItem, subChild.toObject());
-            }
-        } else {
-            nameItem->setIcon(style()->standardIcon(QStyle::SP_FileIcon));
-            typeItem->setText("文件");
-            
-            // 尺寸列显示路径
-            pathItem->setText(childObj["path"].toString());
+    // 层级视图中展开的目录也加入监视
+    connect(treeModel, &DirectoryTreeModel::directoryPopulated, this, [this](NodeId node) {
+        if (treeModel->currentTree() == treeWatcher->watchedTree()) {
+            treeWatcher->addDirectory(node);
         }
-        
-        QList<QStandardItem*> rowItems;
-        rowItems << nameItem << typeItem << pathItem;
-        rootItem->appendRow(rowItems);
+    });
+}
+
+void MainWindow::setWatchChanges(bool enable)
+{
+    watchChanges = enable;
+    updateWatcher();
+}
+
+size_t MainWindow::displayedMemory() const
+{
+    // 压缩包的目录结构缓存不随树释放，一并算作显示所需的内存
+    size_t total = treeTextView->memoryUsage() + ArchiveCache::instance().memoryUsage();
+    if (currentTree) {
+        total += currentTree->nodes.memoryUsage();
+    }
+    return total;
+}
+
+void MainWindow::enforceMemoryBudget()
+{
+    // 正在显示的树不能释放；缓存的超集树被淘汰后，再次需要时从磁盘快照载入
+    if (memoryBudget > 0) {
+        treeCache.trim(size_t(qMax<qint64>(0, memoryBudget - qint64(displayedMemory()))));
+    }
+    updateMemoryStatus();
+}
+
+void MainWindow::updateMemoryStatus(qint64 scanningBytes)
+{
+    QLocale locale;
+    size_t treeBytes = currentTree ? currentTree->nodes.memoryUsage() : 0;
+    size_t cacheBytes = treeCache.memoryUsage();
+    size_t viewBytes = treeTextView->memoryUsage();
+    size_t archiveBytes = ArchiveCache::instance().memoryUsage();
+    qint64 total = qint64(treeBytes + cacheBytes + viewBytes + archiveBytes) + scanningBytes;
+    
+    QString text = "内存 " + locale.formattedDataSize(total);
+    if (memoryBudget > 0) {
+        text += " / " + locale.formattedDataSize(memoryBudget);
+    }
+    memoryLabel->setText(text);
+    
+    QString details = QString("当前的树：%1\n缓存的树：%2\n文本视图：%3")
+            .arg(locale.formattedDataSize(qint64(treeBytes)))
+            .arg(locale.formattedDataSize(qint64(cacheBytes)))
+            .arg(locale.formattedDataSize(qint64(viewBytes)));
+    if (archiveBytes > 0) {
+        details += "\n压缩包目录：" + locale.formattedDataSize(qint64(archiveBytes));
+    }
+    if (scanningBytes > 0) {
+        details += "\n正在扫描：" + locale.formattedDataSize(scanningBytes);
+    }
+    memoryLabel->setToolTip(details);
+}
+
+void MainWindow::showProfileSummary()
+{
+    ScanProfiler &profiler = ScanProfiler::instance();
+    if (!profiler.hasData()) {
+        QMessageBox::information(this, "性能分析", "还没有性能记录。请在“选项 → 高级选项”中开启性能分析后重新扫描");
+        return;
     }
     
-    treeView->expandAll();
-    treeView->resizeColumnToContents(0);
-    treeView->resizeColumnToContents(1);
-    treeView->resizeColumnToContents(2);
+    QMessageBox box(QMessageBox::Information, "性能分析", "最近一次扫描各阶段的耗时", QMessageBox::Ok, this);
+    box.setDetailedText(profiler.summary());
+    box.exec();
 }
 
-void MainWindow::addTreeItem(QStandardItem *parent, const QJsonObject &item)
+void MainWindow::exportProfileTrace()
 {
-    QStandardItem *nameItem = new QStandardItem(item["name"].toString());
-    QStandardItem *typeItem = new QStandardItem();
-    QStandardItem *sizeItem = new QStandardItem();
+    ScanProfiler &profiler = ScanProfiler::instance();
+    if (!profiler.hasData()) {
+        QMessageBox::information(this, "性能分析", "还没有性能记录。请在“选项 → 高级选项”中开启性能分析后重新扫描");
+        return;
+    }
     
-    QString type = item["type"].toString();
-    if (type == "directory") {
-        nameItem->setIcon(style()->standardIcon(QStyle::SP_DirIcon));
-        typeItem->setText("文件夹");
-        
-        // 递归添加子目录
-        QJsonArray children = item["children"].toArray();
-        for (const QJsonValue &child : children) {
-            addTreeItem(nameItem, child.toObject());
-        }
-    } else {
-        nameItem->setIcon(style()->standardIcon(QStyle::SP_FileIcon));
-        typeItem->setText("文件");
-        
-        // 尺寸列显示路径
-        sizeItem->setText(item["path"].toString());
+    QString startPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/scan-trace.json";
+    QString filePath = QFileDialog::getSaveFileName(this, "导出性能跟踪", startPath, "Chrome 跟踪文件 (*.json)");
+    if (filePath.isEmpty()) {
+        return;
+    }
+    
+    QSaveFile file(filePath);
+    QString error;
+    if (!file.open(QIODevice::WriteOnly) || !profiler.writeChromeTrace(&file, &error) || !file.commit()) {
+        QMessageBox::warning(this, "导出失败", error.isEmpty() ? file.errorString() : error);
+        return;
+    }
+    statusBar()->showMessage(QString("性能跟踪已导出到 %1，可在 ui.perfetto.dev 或 chrome://tracing 中打开").arg(filePath));
+}
+
+void MainWindow::updateWatcher()
+{
+    if (!watchChanges || !currentTree) {
+        treeWatcher->stop();
+        return;
     }
     
-    QList<QStandardItem*> rowItems;
-    rowItems << nameItem << typeItem << sizeItem;
-    parent->appendRow(rowItems);
+    if (treeWatcher->watchedTree() != currentTree) {
+        treeWatcher->watch(currentTree, &dirTree);
+        // 导出线程正在读取这棵树时先只记录变化
+        treeWatcher->setPaused(exportSession != nullptr);
+    }
+}
+
+void MainWindow::stopScanSession()
+{
+    if (scanSession) {
+        // 不再接收旧会话的结果；会话对象在线程退出后自行销毁，界面不等待它
+        scanSession->disconnect(this);
+        scanSession->discard();
+        scanSession = nullptr;
+    }
+    
+    cancelButton->setVisible(false);
+    cancelButton->setEnabled(true);
+    updateProgressBar(false);
+}
+
+void MainWindow::cancelScan()
+{
+    if (scanSession) {
+        scanSession->cancel();
+        cancelButton->setEnabled(false);
+        progressBar->setFormat("正在取消...");
+    }
+}
+
+void MainWindow::createTreeViewModel(const std::shared_ptr<ScannedTree> &tree)
+{
+    // 模型直接读取扫描结果；展开尚未读取的目录时用 dirTree 按当前选项列出
+    treeModel->setTree(tree, &dirTree);
+    
+    // 只展开根目录，显示第一层
+    treeView->expand(treeModel->index(0, 0));
+    treeView->resizeColumnToContents(DirectoryTreeModel::TypeColumn);
+    treeView->resizeColumnToContents(DirectoryTreeModel::SizeColumn);
+    treeView->resizeColumnToContents(DirectoryTreeModel::AllocatedColumn);
 }
 
 void MainWindow::exportToFile()
 {
-    if (treeTextEdit->toPlainText().isEmpty() && !isHierarchicalView) {
+    // 下面可能弹出对话框，先取得触发的菜单项
+    QAction *action = qobject_cast<QAction*>(sender());
+    
+    if (!currentTree) {
         QMessageBox::information(this, "提示", "没有内容可导出");
         return;
     }
     
-    QAction *action = qobject_cast<QAction*>(sender());
+    if (exportSession) {
+        QMessageBox::information(this, "提示", "正在导出，请等待完成或取消当前导出");
+        return;
+    }
+    
+    // 达到内存上限的树重新扫描也会在同样的位置停下：部分目录只有汇总，询问是否照此导出
+    if (currentTree->memoryLimited) {
+        QMessageBox::StandardButton answer = QMessageBox::question(this, "导出",
+                QString("扫描达到了内存上限（%1），部分目录只统计了大小，没有列出其中的条目。\n"
+                        "是否导出当前的目录树？提高选项中的内存上限后重新生成可以得到完整的目录树。")
+                        .arg(QLocale().formattedDataSize(memoryBudget)));
+        if (answer != QMessageBox::Yes) {
+            return;
+        }
+    } else if (!currentTree->complete) {
+        // 层级视图只读取了展开过的目录，导出前需要完整扫描
+        QMessageBox::information(this, "提示", "层级视图中的目录是按需读取的，正在完整扫描，完成后请重新导出");
+        startScan(false);
+        return;
+    }
+    
     QString format;
     QString filter;
     
     if (action) {
         QString actionText = action->text();
-        if (actionText.contains(".txt")) {
+        if (actionText.contains(".ndjson")) {
+            format = "ndjson";
+            filter = "NDJSON文件 (*.ndjson)";
+        } else if (actionText.contains(".txt")) {
             format = "txt";
             filter = "文本文件 (*.txt)";
         } else if (actionText.contains(".md")) {
@@ -436,7 +794,7 @@ void MainWindow::exportToFile()
         }
     }
     
-    QFileInfo pathInfo(currentPath);
+    QFileInfo pathInfo(currentTree->rootPath);
     QString defaultFileName = pathInfo.fileName() + "." + format;
     
     // 使用上次的导出路径，如果没有则使用文档目录
@@ -461,69 +819,95 @@ void MainWindow::exportToFile()
     lastExportPath = filePath;
     
     if (format == "txt") {
-        exportToTextFile(filePath);
+        startExport(filePath, ExportFormat::TEXT);
     } else if (format == "md") {
-        exportToMarkdownFile(filePath);
+        startExport(filePath, ExportFormat::MARKDOWN);
     } else if (format == "json") {
-        exportToJsonFile(filePath);
+        startExport(filePath, ExportFormat::JSON);
+    } else if (format == "ndjson") {
+        startExport(filePath, ExportFormat::NDJSON);
     }
 }
 
-void MainWindow::exportToTextFile(const QString &filePath)
+void MainWindow::startExport(const QString &filePath, ExportFormat format)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, "错误", "无法创建文件");
-        return;
-    }
-    
-    OutputFormat originalFormat = currentFormat;
-    dirTree.setOutputFormat(OutputFormat::TEXT);
+    // 在后台线程中边遍历边写入，界面保持响应
+    exportSession = new ExportSession(this);
+    configureTree(exportSession->tree());
     
-    QTextStream out(&file);
-    out << dirTree.generateTree(currentPath);
+    connect(exportSession, &ExportSession::progressChanged, this, [this](int written, int total) {
+        if (total > 0) {
+            exportProgressBar->setRange(0, 100);
+            exportProgressBar->setValue(qMin(100, int(qint64(written) * 100 / total)));
+            exportProgressBar->setFormat(QString("导出中 %p% (%1/%2)").arg(written).arg(total));
+        }
+    });
+    connect(exportSession, &ExportSession::finished, this, [this](bool success) {
+        QString filePath = exportSession->filePath();
+        ExportFormat format = exportSession->format();
+        QString error = exportSession->errorString();
+        stopExportSession();
+        
+        if (!success) {
+            QMessageBox::warning(this, "错误", error.isEmpty() ? QString("无法创建文件") : QString("无法写入文件：%1").arg(error));
+            return;
+        }
+        
+        switch (format) {
+            case ExportFormat::TEXT:
+                QMessageBox::information(this, "成功", "目录树已导出为文本文件");
+                break;
+            case ExportFormat::MARKDOWN:
+                QMessageBox::information(this, "成功", "目录树已导出为Markdown文件");
+                break;
+            case ExportFormat::JSON:
+                QMessageBox::information(this, "成功", "目录树已导出为JSON文件");
+                break;
+            case ExportFormat::NDJSON:
+                QMessageBox::information(this, "成功", "目录树已导出为NDJSON文件");
+                break;
+        }
+        statusBar()->showMessage(QString("已导出到 %1").arg(filePath));
+    });
+    connect(exportSession, &ExportSession::cancelled, this, [this]() {
+        stopExportSession();
+        statusBar()->showMessage("导出已取消");
+    });
     
-    file.close();
+    // 文本导出没有进度计数，显示为忙碌状态
+    exportProgressBar->setRange(0, 0);
+    exportProgressBar->setVisible(true);
+    exportCancelButton->setVisible(true);
+    exportCancelButton->setEnabled(true);
     
-    dirTree.setOutputFormat(originalFormat);
-    QMessageBox::information(this, "成功", "目录树已导出为文本文件");
+    // 导出线程读取树期间不修改它，变化在导出结束后再应用，其中未读取的目录暂不能展开
+    treeWatcher->setPaused(true);
+    treeModel->setFrozenTree(currentTree.get());
+    exportSession->start(currentTree, filePath, format);
 }
 
-void MainWindow::exportToMarkdownFile(const QString &filePath)
+void MainWindow::stopExportSession()
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, "错误", "无法创建文件");
-        return;
+    if (exportSession) {
+        exportSession->disconnect(this);
+        exportSession->cancel();
+        exportSession->deleteLater();
+        exportSession = nullptr;
     }
+    treeWatcher->setPaused(false);
+    treeModel->setFrozenTree(nullptr);
     
-    OutputFormat originalFormat = currentFormat;
-    dirTree.setOutputFormat(OutputFormat::MARKDOWN);
-    
-    QTextStream out(&file);
-    out << dirTree.generateTree(currentPath);
-    
-    file.close();
-    
-    dirTree.setOutputFormat(originalFormat);
-    QMessageBox::information(this, "成功", "目录树已导出为Markdown文件");
+    exportProgressBar->setVisible(false);
+    exportCancelButton->setVisible(false);
 }
 
-void MainWindow::exportToJsonFile(const QString &filePath)
+void MainWindow::cancelExport()
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, "错误", "无法创建文件");
-        return;
+    if (exportSession) {
+        exportSession->cancel();
+        exportCancelButton->setEnabled(false);
+        exportProgressBar->setFormat("正在取消...");
     }
-    
-    QJsonObject jsonTree = dirTree.generateJsonTree(currentPath);
-    QJsonDocument doc(jsonTree);
-    
-    file.write(doc.toJson(QJsonDocument::Indented));
-    file.close();
-    
-    QMessageBox::information(this, "成功", "目录树已导出为JSON文件");
 }
 
 void MainWindow::toggleView()
@@ -546,11 +930,9 @@ void MainWindow::toggleView()
 void MainWindow::switchFormat(int index)
 {
     currentFormat = static_cast<OutputFormat>(index);
-    dirTree.setOutputFormat(currentFormat);
     
     if (!currentPath.isEmpty() && !isHierarchicalView) {
-        QString result = dirTree.generateTree(currentPath);
-        treeTextEdit->setText(result);
+        updateDirectoryTree();
     }
 }
 
@@ -2,7 +2,6 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QTextEdit>
 #include <QLabel>
 #include <QPushButton>
 #include <QVBoxLayout>
@@ -17,10 +16,16 @@
 #include <QComboBox>
 #include <QProgressBar>
 #include <QTreeView>
-#include <QStandardItemModel>
 #include <QSettings>
 #include <QListWidget>
 #include "DirectoryTree.h"
+#include "DirectoryTreeModel.h"
+#include "ExportSession.h"
+#include "TreeTextView.h"
+#include "ScanCache.h"
+#include "ScanSession.h"
+#include "TreeCache.h"
+#include "TreeWatcher.h"
 
 class MainWindow : public QMainWindow
 {
@@ -44,6 +49,12 @@ private slots:
     void exportToFile();
     void toggleView();
     void switchFormat(int index);
+    void cancelScan();
+    void cancelExport();
+    void refreshTree();
+    void setWatchChanges(bool enable);
+    void showProfileSummary();
+    void exportProfileTrace();
     
     // 书签和历史相关槽函数
     void showBookmarkDialog();
@@ -56,17 +67,23 @@ private slots:
 private:
     QWidget *centralWidget;
     QLabel *dropAreaLabel;
-    QTextEdit *treeTextEdit;
+    TreeTextView *treeTextView;
     QTreeView *treeView;
-    QStandardItemModel *treeModel;
+    DirectoryTreeModel *treeModel;
     QPushButton *copyButton;
     QPushButton *optionsButton;
     QToolBar *toolBar;
     QComboBox *formatComboBox;
     QProgressBar *progressBar;
+    QPushButton *cancelButton;
     QMenu *exportMenu;
     QPushButton *exportButton;
     QPushButton *toggleViewButton;
+    QPushButton *refreshButton;
+    QPushButton *watchButton;
+    QProgressBar *exportProgressBar;   // 状态栏中的导出进度
+    QPushButton *exportCancelButton;
+    QLabel *memoryLabel;               // 状态栏中的内存占用
     
     // 书签和历史相关控件
     QPushButton *bookmarkButton;
@@ -77,6 +94,12 @@ private:
     QListWidget *historyList;
     
     DirectoryTree dirTree;
+    ScanSession *scanSession = nullptr;  // 当前正在后台运行的扫描
+    ExportSession *exportSession = nullptr;  // 当前正在后台运行的导出
+    TreeCache treeCache;                 // 已扫描的树，切换视图/格式和导出时复用
+    ScanCache scanCache;                 // 磁盘上的扫描快照，重新打开目录时只验证变化
+    TreeWatcher *treeWatcher;            // 实时更新时监视当前显示的树
+    std::shared_ptr<ScannedTree> currentTree;  // 当前显示的树
     QString currentPath;
     OutputFormat currentFormat;
     bool isHierarchicalView;
@@ -91,17 +114,44 @@ private:
     QString indentChars = "    "; // 默认缩进
     bool showFiles = true;       // 显示文件
     bool showHidden = false;     // 不显示隐藏文件
+    bool followSymlinks = false; // 不跟随符号链接
+    bool oneFileSystem = false;  // 进入其他文件系统的挂载点
+    bool browseArchives = false; // 压缩包作为文件显示
     QStringList ignorePatterns;  // 忽略模式
     SortType sortType = SortType::DIRS_FIRST;  // 排序方式
+    SizeMode sizeMode = SizeMode::NONE;        // 文本输出中显示的大小；显示大小时层级视图也完整扫描
+    int threadCount = QThread::idealThreadCount();  // 扫描线程数
+#ifdef Q_OS_LINUX
+    ScannerBackend scannerBackend = ScannerBackend::NATIVE;  // 扫描后端
+#else
+    ScannerBackend scannerBackend = ScannerBackend::QDIR;
+#endif
+    bool useIoUring = true;      // 需要元数据时使用 io_uring 批量 statx
+    bool usePersistentCache = true;  // 扫描结果保存到磁盘缓存
+    bool watchChanges = false;   // 实时更新：把文件系统的变化直接应用到当前的树上
+    bool profileScans = false;   // 记录扫描各阶段的耗时
+    qint64 memoryBudget = DirectoryTree::defaultMemoryBudget();  // 内存上限（字节），0 表示不限
     
     void setupUI();
     void updateDirectoryTree();
-    void createTreeViewModel(const QJsonObject &jsonTree);
-    void addTreeItem(QStandardItem *parent, const QJsonObject &item);
-    void exportToTextFile(const QString &filePath);
-    void exportToMarkdownFile(const QString &filePath);
-    void exportToJsonFile(const QString &filePath);
+    void startScan(bool shallow);
+    // 层级视图只需要根目录一层，其余目录展开时再读取；文本输出需要完整的树，
+    // 显示大小时目录的汇总也需要完整的树
+    bool shallowScan() const { return isHierarchicalView && sizeMode == SizeMode::NONE; }
+    void showCurrentTree();
+    void configureTree(DirectoryTree &tree) const;
+    void stopScanSession();
+    void createTreeViewModel(const std::shared_ptr<ScannedTree> &tree);
+    void startExport(const QString &filePath, ExportFormat format);
+    void stopExportSession();
     void updateProgressBar(bool visible, int value = 0);
+    void setupWatcher();
+    void updateWatcher();
+    // 当前显示的树及其视图占用的内存
+    size_t displayedMemory() const;
+    // 超出内存上限时淘汰缓存的树，并刷新状态栏中的内存占用
+    void enforceMemoryBudget();
+    void updateMemoryStatus(qint64 scanningBytes = 0);
     
     // 书签和历史相关方法
     void setupBookmarkMenu();
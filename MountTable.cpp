@@ -0,0 +1,129 @@
+#include "MountTable.h"
+#include <QFile>
+#include <QSet>
+#include <QStringList>
+
+#ifdef Q_OS_LINUX
+#include <sys/sysmacros.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_LINUX
+// mountinfo 中的路径把空格、制表符、换行和反斜杠写成 \040 形式的八进制转义
+QString unescape(const QByteArray &field)
+{
+    QByteArray result;
+    result.reserve(field.size());
+    for (int i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size() && field[i + 1] >= '0' && field[i + 1] <= '3') {
+            result += char((field[i + 1] - '0') * 64 + (field[i + 2] - '0') * 8 + (field[i + 3] - '0'));
+            i += 3;
+        } else {
+            result += field[i];
+        }
+    }
+    return QString::fromUtf8(result);
+}
+
+bool isRotational(unsigned major, unsigned minor)
+{
+    // 分区没有自己的 queue 目录，属性在所属的整块磁盘上
+    const QString base = QString("/sys/dev/block/%1:%2/").arg(major).arg(minor);
+    for (const QString &path : { base + "queue/rotational", base + "../queue/rotational" }) {
+        QFile file(path);
+        if (file.open(QIODevice::ReadOnly)) {
+            return file.readAll().trimmed() == "1";
+        }
+    }
+    return false;
+}
+#endif
+
+}
+
+MountTable MountTable::current()
+{
+    MountTable table;
+#ifdef Q_OS_LINUX
+    QFile file("/proc/self/mountinfo");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return table;
+    }
+
+    // 每行：挂载编号 父编号 主:次设备号 根 挂载点 选项 [可选字段...] - 文件系统类型 来源 超级块选项
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        const QList<QByteArray> fields = line.split(' ');
+        int separator = fields.indexOf("-", 6);
+        if (fields.size() < 5 || separator < 0 || separator + 2 >= fields.size()) {
+            continue;
+        }
+        const QList<QByteArray> numbers = fields[2].split(':');
+        if (numbers.size() != 2) {
+            continue;
+        }
+        unsigned major = numbers[0].toUInt();
+        unsigned minor = numbers[1].toUInt();
+
+        MountInfo mount;
+        mount.mountPoint = unescape(fields[4]);
+        mount.fsType = QString::fromUtf8(fields[separator + 1]);
+        mount.source = unescape(fields[separator + 2]);
+        mount.device = quint64(makedev(major, minor));
+        mount.network = isNetworkFileSystem(mount.fsType);
+        mount.pseudo = isPseudoFileSystem(mount.fsType);
+        // 只有真正的块设备才有 rotational 属性
+        mount.rotational = !mount.network && !mount.pseudo && mount.source.startsWith("/dev/")
+                && isRotational(major, minor);
+
+        // 同一设备挂载多次（绑定挂载）时属性相同，后挂载的覆盖先挂载的
+        table.byDevice.insert(mount.device, table.entries.size());
+        table.entries.append(mount);
+    }
+#endif
+    return table;
+}
+
+const MountInfo *MountTable::find(quint64 device) const
+{
+    auto it = byDevice.constFind(device);
+    return it == byDevice.constEnd() ? nullptr : &entries[it.value()];
+}
+
+int MountTable::concurrencyFor(quint64 device, int localConcurrency) const
+{
+    const MountInfo *mount = find(device);
+    if (!mount) {
+        return localConcurrency;
+    }
+    if (mount->network) {
+        return qBound(MIN_NETWORK_CONCURRENCY, localConcurrency * 2, MAX_NETWORK_CONCURRENCY);
+    }
+    if (mount->pseudo) {
+        return 1;
+    }
+    if (mount->rotational) {
+        return qMin(localConcurrency, ROTATIONAL_CONCURRENCY);
+    }
+    return localConcurrency;
+}
+
+bool MountTable::isNetworkFileSystem(const QString &fsType)
+{
+    static const QSet<QString> types = {
+        "nfs", "nfs4", "cifs", "smb3", "smbfs", "ncpfs", "afs", "9p", "ceph", "glusterfs", "lustre",
+        "gpfs", "beegfs", "fuse.sshfs", "fuse.s3fs", "fuse.rclone", "fuse.glusterfs", "davfs", "fuse.davfs2"
+    };
+    return types.contains(fsType);
+}
+
+bool MountTable::isPseudoFileSystem(const QString &fsType)
+{
+    static const QSet<QString> types = {
+        "proc", "sysfs", "devtmpfs", "devpts", "cgroup", "cgroup2", "securityfs", "debugfs", "tracefs",
+        "pstore", "bpf", "configfs", "fusectl", "mqueue", "hugetlbfs", "autofs", "binfmt_misc",
+        "efivarfs", "nsfs", "rpc_pipefs", "selinuxfs"
+    };
+    return types.contains(fsType);
+}
@@ -0,0 +1,45 @@
+#ifndef MOUNTTABLE_H
+#define MOUNTTABLE_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// 一个挂载点
+struct MountInfo {
+    QString mountPoint;
+    QString fsType;
+    QString source;         // 设备或远程地址，如 /dev/sda1、server:/export
+    quint64 device = 0;     // 与 stat 的 st_dev 编码一致
+    bool network = false;   // NFS、SMB 等网络文件系统
+    bool pseudo = false;    // proc、sysfs 等内核虚拟文件系统
+    bool rotational = false;  // 所在的块设备是机械硬盘
+};
+
+// 系统的挂载表（Linux 读取 /proc/self/mountinfo），按设备号查找挂载点，
+// 并据此为每个设备给出合适的扫描并发数。其他平台上为空表，所有设备都按本地磁盘处理
+class MountTable
+{
+public:
+    static constexpr int ROTATIONAL_CONCURRENCY = 2;   // 机械硬盘并发过高只会增加寻道
+    static constexpr int MIN_NETWORK_CONCURRENCY = 4;  // 网络文件系统受往返延迟限制，更多并发的请求才能填满链路
+    static constexpr int MAX_NETWORK_CONCURRENCY = 16;
+
+    // 读取当前的挂载表，失败时返回空表
+    static MountTable current();
+
+    const QVector<MountInfo> &mounts() const { return entries; }
+    // device 上最后挂载的文件系统，未知的设备返回 nullptr
+    const MountInfo *find(quint64 device) const;
+    // 扫描 device 上的目录时同时读取的目录数；localConcurrency 为本地磁盘使用的线程数
+    int concurrencyFor(quint64 device, int localConcurrency) const;
+
+    static bool isNetworkFileSystem(const QString &fsType);
+    static bool isPseudoFileSystem(const QString &fsType);
+
+private:
+    QVector<MountInfo> entries;
+    QHash<quint64, int> byDevice;
+};
+
+#endif // MOUNTTABLE_H
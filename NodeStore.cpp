@@ -0,0 +1,526 @@
+#include "NodeStore.h"
+#include <QHash>
+#include <QStringList>
+#include <cstring>
+
+quint32 StringPool::append(const char *data, int length)
+{
+    if (length > int(CHUNK_SIZE)) {
+        length = int(CHUNK_SIZE);
+    }
+
+    // 当前块放不下时开新块，名称不会跨块存放
+    if (used + quint32(length) > CHUNK_SIZE) {
+        chunks.emplace_back(new char[CHUNK_SIZE]);
+        used = 0;
+    }
+
+    quint32 offset = (quint32(chunks.size() - 1) << CHUNK_BITS) | used;
+    memcpy(chunks.back().get() + used, data, size_t(length));
+    used += quint32(length);
+    return offset;
+}
+
+NodeId NodeStore::createRoot(const QString &name)
+{
+    return appendNode(INVALID_NODE, name, DIRECTORY, 0);
+}
+
+NodeId NodeStore::appendNode(NodeId parent, const QString &name, quint8 flags, qint64 modifiedTime)
+{
+    const QByteArray utf8 = name.toUtf8();
+    return appendNode(parent, utf8.constData(), utf8.size(), flags, modifiedTime);
+}
+
+NodeId NodeStore::appendNode(NodeId parent, const char *name, int length, quint8 flags, qint64 modifiedTime)
+{
+    length = qMin(length, 0xFFFF);
+
+    NodeId id = NodeId(parents.size());
+    parents.push_back(parent);
+    firstChildren.push_back(INVALID_NODE);
+    childCounts.push_back(0);
+    nameOffsets.push_back(names.append(name, length));
+    nameLengths.push_back(quint16(length));
+    nodeFlags.push_back(flags);
+    modifiedTimes.push_back(modifiedTime);
+    sizes.push_back(0);
+    allocatedSizes.push_back(0);
+    descendantCounts.push_back(0);
+    return id;
+}
+
+void NodeStore::copySizes(NodeId id, const NodeStore &source, NodeId from)
+{
+    sizes[id] = source.sizes[from];
+    allocatedSizes[id] = source.allocatedSizes[from];
+    descendantCounts[id] = source.descendantCounts[from];
+}
+
+NodeId NodeStore::appendChildren(NodeId parent, const QVector<DirEntry> &entries)
+{
+    NodeId first = NodeId(parents.size());
+    // 展开汇总目录时记下它，汇总值保留到子树读完
+    if ((nodeFlags[parent] & (POPULATED | COMPLETE)) == COMPLETE) {
+        expandedSummaries.insert(parent);
+    }
+
+    for (const DirEntry &entry : entries) {
+        quint8 flags = (entry.isDir() ? DIRECTORY : 0) | (entry.hidden ? HIDDEN : 0)
+                | (entry.symlink ? SYMLINK : 0) | (entry.duplicate ? DUPLICATE : 0) | (entry.archive ? ARCHIVE : 0);
+        NodeId id = appendNode(parent, entry.name, flags, entry.modifiedTime);
+        // 目录的大小是其下条目的汇总，读取前为 0，不用文件系统报告的目录自身大小
+        if (!entry.isDir() || entry.archive) {
+            sizes[id] = entry.size;
+            allocatedSizes[id] = entry.allocatedSize;
+        }
+    }
+
+    firstChildren[parent] = entries.isEmpty() ? INVALID_NODE : first;
+    childCounts[parent] = quint32(entries.size());
+    nodeFlags[parent] |= POPULATED;
+    return first;
+}
+
+NodeId NodeStore::appendChildren(NodeId parent, const NodeStore &source, const NodeId *children, int count)
+{
+    NodeId first = NodeId(parents.size());
+
+    for (int i = 0; i < count; ++i) {
+        NodeId child = children[i];
+        NodeId id = appendNode(parent, source.nameData(child), source.nameLength(child),
+                               source.flags(child) & (DIRECTORY | HIDDEN | SYMLINK | DUPLICATE | ARCHIVE | COMPLETE | EXCLUDED),
+                               source.modifiedTime(child));
+        copySizes(id, source, child);
+        if (source.expandedSummaries.count(child)) {
+            expandedSummaries.insert(id);
+        }
+    }
+
+    firstChildren[parent] = count == 0 ? INVALID_NODE : first;
+    childCounts[parent] = quint32(count);
+    nodeFlags[parent] |= POPULATED;
+    return first;
+}
+
+NodeId NodeStore::replaceChildren(NodeId parent, const QVector<DirEntry> &entries, QVector<NodeId> *previous)
+{
+    NodeId oldFirst = firstChildren[parent];
+    int oldCount = int(childCounts[parent]);
+
+    QHash<QString, NodeId> oldByName;
+    oldByName.reserve(oldCount);
+    for (int i = 0; i < oldCount; ++i) {
+        NodeId old = oldFirst + NodeId(i);
+        oldByName.insert(name(old), old);
+    }
+
+    NodeId first = appendChildren(parent, entries);
+    if (previous) {
+        previous->clear();
+        previous->reserve(entries.size());
+    }
+
+    for (int i = 0; i < entries.size(); ++i) {
+        NodeId id = first + NodeId(i);
+        NodeId old = oldByName.value(entries.at(i).name, INVALID_NODE);
+        if (old != INVALID_NODE && isDir(old) != entries.at(i).isDir()) {
+            old = INVALID_NODE;
+        }
+
+        // 仍然存在的子目录接管原来的子树，孙节点改挂到新编号下
+        if (old != INVALID_NODE && isDir(old)) {
+            firstChildren[id] = firstChildren[old];
+            childCounts[id] = childCounts[old];
+            nodeFlags[id] |= nodeFlags[old] & (POPULATED | COMPLETE | EXCLUDED);
+            if (expandedSummaries.erase(old)) {
+                expandedSummaries.insert(id);
+            }
+            modifiedTimes[id] = modifiedTimes[old];
+            // 压缩包的大小是文件本身的，以新读到的为准
+            if (!isArchive(id)) {
+                copySizes(id, *this, old);
+            } else {
+                descendantCounts[id] = descendantCounts[old];
+            }
+            for (quint32 c = 0; c < childCounts[old]; ++c) {
+                parents[firstChildren[old] + c] = id;
+            }
+        }
+        if (previous) {
+            previous->append(old);
+        }
+    }
+
+    orphaned += oldCount;
+    return first;
+}
+
+NodeStore NodeStore::compacted(NodeId root, std::vector<NodeId> &oldToNew) const
+{
+    NodeStore result;
+    oldToNew.assign(parents.size(), INVALID_NODE);
+
+    NodeId newRoot = result.appendNode(INVALID_NODE, nameData(root), nameLength(root), nodeFlags[root], modifiedTimes[root]);
+    result.copySizes(newRoot, *this, root);
+    oldToNew[root] = newRoot;
+
+    // 按目录逐块复制，保持同一目录的子节点连续
+    std::vector<NodeId> queue;
+    queue.push_back(root);
+    for (size_t next = 0; next < queue.size(); ++next) {
+        NodeId dir = queue[next];
+        NodeId newDir = oldToNew[dir];
+        int count = childCount(dir);
+        if (count == 0) {
+            continue;
+        }
+
+        NodeId first = NodeId(result.parents.size());
+        for (int i = 0; i < count; ++i) {
+            NodeId c = child(dir, i);
+            oldToNew[c] = result.appendNode(newDir, nameData(c), nameLength(c), nodeFlags[c], modifiedTimes[c]);
+            result.copySizes(oldToNew[c], *this, c);
+            if (childCounts[c] > 0) {
+                queue.push_back(c);
+            }
+        }
+        result.firstChildren[newDir] = first;
+        result.childCounts[newDir] = quint32(count);
+    }
+    for (NodeId id : expandedSummaries) {
+        if (oldToNew[id] != INVALID_NODE) {
+            result.expandedSummaries.insert(oldToNew[id]);
+        }
+    }
+    return result;
+}
+
+void NodeStore::aggregateSizes()
+{
+    // 已展开的汇总目录也按子节点重新累加，子树没有读完时再换回汇总值
+    struct Summary {
+        qint64 size;
+        qint64 allocated;
+        quint32 count;
+    };
+    QHash<NodeId, Summary> summaries;
+    for (NodeId id : expandedSummaries) {
+        summaries.insert(id, { sizes[id], allocatedSizes[id], descendantCounts[id] });
+    }
+
+    for (size_t i = 0; i < parents.size(); ++i) {
+        if ((nodeFlags[i] & DIRECTORY) && ((nodeFlags[i] & POPULATED) || !(nodeFlags[i] & COMPLETE))) {
+            if (!(nodeFlags[i] & ARCHIVE)) {
+                sizes[i] = 0;
+                allocatedSizes[i] = 0;
+            }
+            descendantCounts[i] = 0;
+            nodeFlags[i] = quint8((nodeFlags[i] & ~COMPLETE) | ((nodeFlags[i] & POPULATED) ? COMPLETE : 0));
+        }
+    }
+
+    // 处理到某个节点时，编号更大的后代都已累加完毕，完整标记也已确定
+    for (size_t i = parents.size(); i-- > 0;) {
+        auto summary = summaries.constFind(NodeId(i));
+        if (summary != summaries.constEnd()) {
+            if (nodeFlags[i] & COMPLETE) {
+                expandedSummaries.erase(NodeId(i));
+            } else {
+                sizes[i] = summary->size;
+                allocatedSizes[i] = summary->allocated;
+                descendantCounts[i] = summary->count;
+                nodeFlags[i] |= COMPLETE;
+            }
+        }
+
+        NodeId parent = parents[i];
+        if (parent == INVALID_NODE) {
+            continue;
+        }
+        if (blocksCompletion(NodeId(i))) {
+            nodeFlags[parent] &= quint8(~COMPLETE);
+        }
+        if (!contributes(NodeId(i))) {
+            continue;
+        }
+        if (!(nodeFlags[parent] & ARCHIVE)) {
+            sizes[parent] += sizes[i];
+            allocatedSizes[parent] += allocatedSizes[i];
+        }
+        descendantCounts[parent] += descendantCounts[i] + 1;
+    }
+}
+
+void NodeStore::updateAggregates(NodeId dir)
+{
+    qint64 sizeDelta;
+    qint64 allocatedDelta;
+    qint64 countDelta;
+    bool completionChanged = recomputeAggregates(dir, sizeDelta, allocatedDelta, countDelta);
+
+    for (NodeId node = dir; parents[node] != INVALID_NODE; node = parents[node]) {
+        if (!contributes(node)) {
+            break;
+        }
+        NodeId parent = parents[node];
+        // 压缩包不改变上级的完整性，它自己的大小也不随其中的条目变化
+        if (nodeFlags[node] & ARCHIVE) {
+            completionChanged = false;
+        }
+        if (expandedSummaries.count(parent)) {
+            // 汇总值已经包含这棵子树，不累加变化量，只检查子树是否已经读完
+            if (!completionChanged) {
+                break;
+            }
+            completionChanged = recomputeAggregates(parent, sizeDelta, allocatedDelta, countDelta);
+        } else {
+            if (nodeFlags[parent] & ARCHIVE) {
+                sizeDelta = 0;
+                allocatedDelta = 0;
+            }
+            sizes[parent] += sizeDelta;
+            allocatedSizes[parent] += allocatedDelta;
+            descendantCounts[parent] = quint32(qint64(descendantCounts[parent]) + countDelta);
+            completionChanged = completionChanged && updateCompletion(parent);
+        }
+        if (sizeDelta == 0 && allocatedDelta == 0 && countDelta == 0 && !completionChanged) {
+            break;
+        }
+    }
+}
+
+bool NodeStore::recomputeAggregates(NodeId dir, qint64 &sizeDelta, qint64 &allocatedDelta, qint64 &countDelta)
+{
+    // 子目录的汇总保持原样（沿用的子树已经汇总过，新出现的目录尚未读取）
+    qint64 size = 0;
+    qint64 allocated = 0;
+    quint32 count = 0;
+    bool complete = nodeFlags[dir] & POPULATED;
+    for (quint32 i = 0; i < childCounts[dir]; ++i) {
+        NodeId child = firstChildren[dir] + i;
+        complete = complete && !blocksCompletion(child);
+        if (!contributes(child)) {
+            continue;
+        }
+        size += sizes[child];
+        allocated += allocatedSizes[child];
+        count += descendantCounts[child] + 1;
+    }
+
+    sizeDelta = 0;
+    allocatedDelta = 0;
+    countDelta = 0;
+    if (expandedSummaries.count(dir)) {
+        if (!complete) {
+            return false;
+        }
+        // 子树已经读完，按子节点算出的汇总取代扫描时统计的值
+        expandedSummaries.erase(dir);
+    }
+
+    if (!(nodeFlags[dir] & ARCHIVE)) {
+        sizeDelta = size - sizes[dir];
+        allocatedDelta = allocated - allocatedSizes[dir];
+        sizes[dir] = size;
+        allocatedSizes[dir] = allocated;
+    }
+    countDelta = qint64(count) - qint64(descendantCounts[dir]);
+    descendantCounts[dir] = count;
+
+    bool changed = complete != bool(nodeFlags[dir] & COMPLETE);
+    nodeFlags[dir] = quint8((nodeFlags[dir] & ~COMPLETE) | (complete ? COMPLETE : 0));
+    return changed;
+}
+
+bool NodeStore::updateCompletion(NodeId dir)
+{
+    bool complete = nodeFlags[dir] & POPULATED;
+    for (quint32 i = 0; complete && i < childCounts[dir]; ++i) {
+        complete = !blocksCompletion(firstChildren[dir] + i);
+    }
+    bool changed = complete != bool(nodeFlags[dir] & COMPLETE);
+    nodeFlags[dir] = quint8((nodeFlags[dir] & ~COMPLETE) | (complete ? COMPLETE : 0));
+    return changed;
+}
+
+void NodeStore::reserve(int count)
+{
+    parents.reserve(size_t(count));
+    firstChildren.reserve(size_t(count));
+    childCounts.reserve(size_t(count));
+    nameOffsets.reserve(size_t(count));
+    nameLengths.reserve(size_t(count));
+    nodeFlags.reserve(size_t(count));
+    modifiedTimes.reserve(size_t(count));
+    sizes.reserve(size_t(count));
+    allocatedSizes.reserve(size_t(count));
+    descendantCounts.reserve(size_t(count));
+}
+
+int NodeStore::depth(NodeId id) const
+{
+    int result = 0;
+    while (parents[id] != INVALID_NODE) {
+        id = parents[id];
+        ++result;
+    }
+    return result;
+}
+
+QString NodeStore::path(NodeId id, const QString &rootPath) const
+{
+    QStringList parts;
+    while (parents[id] != INVALID_NODE) {
+        parts.prepend(name(id));
+        id = parents[id];
+    }
+
+    if (parts.isEmpty()) {
+        return rootPath;
+    }
+
+    QString result = rootPath;
+    if (!result.endsWith('/')) {
+        result += '/';
+    }
+    return result + parts.join('/');
+}
+
+size_t NodeStore::memoryUsage() const
+{
+    return parents.capacity() * sizeof(NodeId)
+            + firstChildren.capacity() * sizeof(NodeId)
+            + childCounts.capacity() * sizeof(quint32)
+            + nameOffsets.capacity() * sizeof(quint32)
+            + nameLengths.capacity() * sizeof(quint16)
+            + nodeFlags.capacity() * sizeof(quint8)
+            + modifiedTimes.capacity() * sizeof(qint64)
+            + sizes.capacity() * sizeof(qint64)
+            + allocatedSizes.capacity() * sizeof(qint64)
+            + descendantCounts.capacity() * sizeof(quint32)
+            + names.memoryUsage();
+}
+namespace {
+
+template <typename T>
+bool writeArray(QIODevice *device, const std::vector<T> &values)
+{
+    qint64 bytes = qint64(values.size() * sizeof(T));
+    return bytes == 0 || device->write(reinterpret_cast<const char *>(values.data()), bytes) == bytes;
+}
+
+template <typename T>
+bool readArray(const char *&data, const char *end, std::vector<T> &values, size_t count)
+{
+    size_t bytes = count * sizeof(T);
+    if (size_t(end - data) < bytes) {
+        return false;
+    }
+    values.resize(count);
+    memcpy(values.data(), data, bytes);
+    data += bytes;
+    return true;
+}
+
+struct SnapshotHeader {
+    quint32 nodeCount;
+    quint32 chunkCount;
+    quint32 lastChunkUsed;
+    quint32 reserved;
+};
+
+}
+
+bool NodeStore::save(QIODevice *device) const
+{
+    SnapshotHeader header;
+    header.nodeCount = quint32(parents.size());
+    header.chunkCount = quint32(names.chunks.size());
+    header.lastChunkUsed = names.chunks.empty() ? 0 : names.used;
+    header.reserved = 0;
+    if (device->write(reinterpret_cast<const char *>(&header), sizeof(header)) != qint64(sizeof(header))) {
+        return false;
+    }
+
+    if (!writeArray(device, parents) || !writeArray(device, firstChildren) || !writeArray(device, childCounts)
+            || !writeArray(device, nameOffsets) || !writeArray(device, nameLengths)
+            || !writeArray(device, nodeFlags) || !writeArray(device, modifiedTimes)
+            || !writeArray(device, sizes) || !writeArray(device, allocatedSizes)
+            || !writeArray(device, descendantCounts)) {
+        return false;
+    }
+
+    // 名称块保持原有的划分，偏移量无需改写；最后一块只写出已使用的部分
+    for (size_t i = 0; i < names.chunks.size(); ++i) {
+        qint64 bytes = i + 1 == names.chunks.size() ? qint64(names.used) : qint64(StringPool::CHUNK_SIZE);
+        if (device->write(names.chunks[i].get(), bytes) != bytes) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool NodeStore::load(const char *&data, const char *end)
+{
+    SnapshotHeader header;
+    if (size_t(end - data) < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    data += sizeof(header);
+
+    if (header.lastChunkUsed > StringPool::CHUNK_SIZE || (header.chunkCount == 0) != (header.lastChunkUsed == 0)) {
+        return false;
+    }
+
+    size_t count = header.nodeCount;
+    if (!readArray(data, end, parents, count) || !readArray(data, end, firstChildren, count)
+            || !readArray(data, end, childCounts, count) || !readArray(data, end, nameOffsets, count)
+            || !readArray(data, end, nameLengths, count) || !readArray(data, end, nodeFlags, count)
+            || !readArray(data, end, modifiedTimes, count) || !readArray(data, end, sizes, count)
+            || !readArray(data, end, allocatedSizes, count) || !readArray(data, end, descendantCounts, count)) {
+        return false;
+    }
+
+    names.chunks.clear();
+    for (quint32 i = 0; i < header.chunkCount; ++i) {
+        size_t bytes = i + 1 == header.chunkCount ? header.lastChunkUsed : StringPool::CHUNK_SIZE;
+        if (size_t(end - data) < bytes) {
+            return false;
+        }
+        names.chunks.emplace_back(new char[StringPool::CHUNK_SIZE]);
+        memcpy(names.chunks.back().get(), data, bytes);
+        data += bytes;
+    }
+    names.used = header.chunkCount == 0 ? StringPool::CHUNK_SIZE : header.lastChunkUsed;
+
+    // 快照来自磁盘，编号和偏移量越界的文件一律视为损坏。结构也要与扫描时一致：根节点编号为 0，
+    // 其余节点的父节点编号都小于自身（沿父节点链一定回到根，aggregateSizes 依赖这一顺序），
+    // 子节点区间在父节点之后且其中每个节点的父节点就是它
+    if (count == 0 || count >= INVALID_NODE || parents[0] != INVALID_NODE) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0 && parents[i] >= i) {
+            return false;
+        }
+        if (childCounts[i] > 0) {
+            if (firstChildren[i] <= i || firstChildren[i] >= count || childCounts[i] > count - firstChildren[i]) {
+                return false;
+            }
+            for (quint32 c = 0; c < childCounts[i]; ++c) {
+                if (parents[firstChildren[i] + c] != NodeId(i)) {
+                    return false;
+                }
+            }
+        }
+        quint32 chunk = nameOffsets[i] >> StringPool::CHUNK_BITS;
+        quint32 offset = nameOffsets[i] & (StringPool::CHUNK_SIZE - 1);
+        quint32 limit = chunk + 1 == header.chunkCount ? header.lastChunkUsed : StringPool::CHUNK_SIZE;
+        if (chunk >= header.chunkCount || offset + nameLengths[i] > limit) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,178 @@
+#ifndef NODESTORE_H
+#define NODESTORE_H
+
+#include <QIODevice>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+#include "FileSystemBackend.h"
+
+using NodeId = quint32;
+const NodeId INVALID_NODE = 0xFFFFFFFFu;
+
+// 追加式字符串池：名称以 UTF-8 形式连续存放在固定大小的块中，
+// 块一旦分配就不再移动，因此已返回的偏移量始终有效
+class StringPool
+{
+public:
+    static constexpr quint32 CHUNK_BITS = 20;
+    static constexpr quint32 CHUNK_SIZE = 1u << CHUNK_BITS;
+
+    quint32 append(const char *data, int length);
+    const char *data(quint32 offset) const
+    {
+        return chunks[offset >> CHUNK_BITS].get() + (offset & (CHUNK_SIZE - 1));
+    }
+    size_t memoryUsage() const { return chunks.size() * size_t(CHUNK_SIZE); }
+
+private:
+    friend class NodeStore;  // 快照读写直接访问各个块
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    quint32 used = CHUNK_SIZE;  // 当前块已使用的字节数
+};
+
+// 结构数组形式的目录树节点存储。
+// 每个节点只占用几个定长字段，同一目录的子节点编号连续，
+// 完整路径不保存，需要时沿父节点链重建
+class NodeStore
+{
+public:
+    enum NodeFlag : quint8 {
+        DIRECTORY = 0x01,
+        POPULATED = 0x02,  // 目录内容已经读取
+        HIDDEN = 0x04,
+        SYMLINK = 0x08,    // 经符号链接到达
+        DUPLICATE = 0x10,  // 同一文件已在别处计入，aggregateSizes 不再累加
+        ARCHIVE = 0x20,    // 作为目录浏览的压缩包：大小是压缩包文件本身的，不累加其中的条目
+        COMPLETE = 0x40,   // 目录及其下的目录都已读取，汇总的大小和条目数完整；
+                           // 没有 POPULATED 时是只统计了汇总、没有保存条目的目录（达到内存上限时）
+        EXCLUDED = 0x80    // 按选项有意不读取的目录（隐藏或被忽略的目录、其他文件系统的挂载点、经符号链接重复到达的目录），
+                           // 与 du 一样不计入上级的汇总，也不使上级的汇总不完整
+    };
+
+    NodeStore() = default;
+    NodeStore(const NodeStore &) = delete;
+    NodeStore &operator=(const NodeStore &) = delete;
+    NodeStore(NodeStore &&) = default;
+    NodeStore &operator=(NodeStore &&) = default;
+
+    NodeId createRoot(const QString &name);
+
+    // 为 parent 追加一组连续的子节点，并把 parent 标记为已读取。返回第一个子节点编号
+    NodeId appendChildren(NodeId parent, const QVector<DirEntry> &entries);
+    // 从另一个存储复制一组节点（名称、类型和修改时间，不含子节点）作为 parent 的子节点
+    NodeId appendChildren(NodeId parent, const NodeStore &source, const NodeId *children, int count);
+
+    // 用新的子项替换 parent 的子节点（目录内容变化时）。新子节点连续追加在末尾，原来的子节点成为孤立节点；
+    // 名称相同且仍是目录的子节点沿用原来已读取的子树。previous 可选，返回每个新子节点对应的原编号，
+    // 新出现的条目为 INVALID_NODE
+    NodeId replaceChildren(NodeId parent, const QVector<DirEntry> &entries, QVector<NodeId> *previous = nullptr);
+    // 把每个目录的大小、占用空间和条目数改为其下所有条目之和（目录自身占用的块不计入，
+    // 硬链接等重复的文件只计一次；压缩包保留文件本身的大小，只统计条目数）。子节点编号总是大于父节点，倒序遍历一次即可自底向上累加
+    void aggregateSizes();
+    // 目录 dir 的子节点变化后（按需读取、监视到变化），按其直接子节点重新计算它的汇总，
+    // 并把变化量沿父节点链向上传递。只访问 dir 和上级目录的子节点，与整棵树的大小无关
+    void updateAggregates(NodeId dir);
+    // 被替换下来、不再可达的直接子节点数（其子树不计在内）
+    int orphanedCount() const { return orphaned; }
+    // 只复制从 root 可达的节点，得到紧凑的新存储；oldToNew 返回编号映射，不可达的节点映射为 INVALID_NODE
+    NodeStore compacted(NodeId root, std::vector<NodeId> &oldToNew) const;
+
+    void reserve(int count);
+    // 目录节点记录的是读取该目录时它自身的修改时间，用于判断目录内容是否变化
+    void setModifiedTime(NodeId id, qint64 time) { modifiedTimes[id] = time; }
+    void markExcluded(NodeId id) { nodeFlags[id] |= EXCLUDED; }
+    // 把未读取的目录记为汇总：只有其下所有条目的大小、占用空间和条目数，没有子节点。aggregateSizes 保留这些值。
+    // 汇总目录被展开（追加子节点）后仍保留汇总值和完整标记，直到其下的目录都已读取、按子节点算出的汇总完整为止
+    void setSummary(NodeId dir, qint64 size, qint64 allocated, quint32 count)
+    {
+        sizes[dir] = size;
+        allocatedSizes[dir] = allocated;
+        descendantCounts[dir] = count;
+        nodeFlags[dir] |= COMPLETE;
+    }
+    void setDuplicate(NodeId id, bool duplicate)
+    {
+        nodeFlags[id] = duplicate ? quint8(nodeFlags[id] | DUPLICATE) : quint8(nodeFlags[id] & ~DUPLICATE);
+    }
+
+    int size() const { return int(parents.size()); }
+    NodeId parent(NodeId id) const { return parents[id]; }
+    NodeId firstChild(NodeId id) const { return firstChildren[id]; }
+    int childCount(NodeId id) const { return int(childCounts[id]); }
+    NodeId child(NodeId id, int index) const { return firstChildren[id] + NodeId(index); }
+    // 节点在父目录中的序号
+    int row(NodeId id) const { return int(id - firstChildren[parents[id]]); }
+    // 根节点深度为 0
+    int depth(NodeId id) const;
+
+    quint8 flags(NodeId id) const { return nodeFlags[id]; }
+    bool isDir(NodeId id) const { return nodeFlags[id] & DIRECTORY; }
+    bool isPopulated(NodeId id) const { return nodeFlags[id] & POPULATED; }
+    bool isHidden(NodeId id) const { return nodeFlags[id] & HIDDEN; }
+    bool isSymlink(NodeId id) const { return nodeFlags[id] & SYMLINK; }
+    bool isDuplicate(NodeId id) const { return nodeFlags[id] & DUPLICATE; }
+    bool isArchive(NodeId id) const { return nodeFlags[id] & ARCHIVE; }
+    bool isComplete(NodeId id) const { return nodeFlags[id] & COMPLETE; }
+    bool isExcluded(NodeId id) const { return nodeFlags[id] & EXCLUDED; }
+    bool isSummary(NodeId id) const
+    {
+        return (nodeFlags[id] & (POPULATED | COMPLETE)) == COMPLETE || expandedSummaries.count(id) > 0;
+    }
+    qint64 modifiedTime(NodeId id) const { return modifiedTimes[id]; }
+    // 文件为自身的值，目录在 aggregateSizes 之后为其下所有条目之和
+    qint64 apparentSize(NodeId id) const { return sizes[id]; }
+    qint64 allocatedSize(NodeId id) const { return allocatedSizes[id]; }
+    // 目录下（递归）的条目数，文件为 0
+    quint32 descendantCount(NodeId id) const { return descendantCounts[id]; }
+
+    const char *nameData(NodeId id) const { return names.data(nameOffsets[id]); }
+    int nameLength(NodeId id) const { return nameLengths[id]; }
+    QString name(NodeId id) const { return QString::fromUtf8(nameData(id), nameLength(id)); }
+
+    // 由根目录路径和父节点链重建完整路径
+    QString path(NodeId id, const QString &rootPath) const;
+
+    size_t memoryUsage() const;
+
+    // 二进制快照：各字段数组和名称块按本机字节序原样写出，读取时整块复制。
+    // load 从 data 开始解析，成功时 data 前移到快照之后；格式不正确时返回 false
+    bool save(QIODevice *device) const;
+    bool load(const char *&data, const char *end);
+
+private:
+    std::vector<NodeId> parents;
+    std::vector<NodeId> firstChildren;
+    std::vector<quint32> childCounts;
+    std::vector<quint32> nameOffsets;
+    std::vector<quint16> nameLengths;
+    std::vector<quint8> nodeFlags;
+    std::vector<qint64> modifiedTimes;
+    std::vector<qint64> sizes;
+    std::vector<qint64> allocatedSizes;
+    std::vector<quint32> descendantCounts;
+    StringPool names;
+    int orphaned = 0;
+    std::unordered_set<NodeId> expandedSummaries;  // 已展开但其下还有未读取目录的汇总目录
+
+    NodeId appendNode(NodeId parent, const QString &name, quint8 flags, qint64 modifiedTime);
+    NodeId appendNode(NodeId parent, const char *name, int length, quint8 flags, qint64 modifiedTime);
+    void copySizes(NodeId id, const NodeStore &source, NodeId from);
+    // 子节点是否计入上级的汇总
+    bool contributes(NodeId child) const { return !(nodeFlags[child] & (DUPLICATE | EXCLUDED)); }
+    // 子节点是否使上级的汇总不完整：未读取完的普通目录（压缩包的大小总是已知的）
+    bool blocksCompletion(NodeId child) const
+    {
+        return (nodeFlags[child] & (DIRECTORY | ARCHIVE | EXCLUDED | COMPLETE)) == DIRECTORY;
+    }
+    // 按直接子节点重新计算目录的完整标记，返回它是否改变
+    bool updateCompletion(NodeId dir);
+    // 按直接子节点重新计算目录的汇总，通过参数返回变化量，返回完整标记是否改变。
+    // 已展开的汇总目录在子树读完之前保持原值，变化量为 0
+    bool recomputeAggregates(NodeId dir, qint64 &sizeDelta, qint64 &allocatedDelta, qint64 &countDelta);
+};
+
+#endif // NODESTORE_H
\ No newline at end of file
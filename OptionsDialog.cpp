@@ -9,6 +9,8 @@
 #include <QPalette>
 #include <QStyle>
 #include <QFontDatabase>
+#include <QThread>
+#include "IoUringStatx.h"
 
 OptionsDialog::OptionsDialog(const QString &currentIndent, int currentDepth, 
                            bool showFiles, bool showHidden, QWidget *parent)
@@ -111,8 +113,23 @@ OptionsDialog::OptionsDialog(const QString &currentIndent, int currentDepth,
     showHiddenCheckBox = new QCheckBox("显示隐藏文件");
     showHiddenCheckBox->setChecked(showHidden);
     
+    followSymlinksCheckBox = new QCheckBox("跟随符号链接");
+    followSymlinksCheckBox->setToolTip("进入符号链接指向的目录；每个目录只读取一次，"
+                                       "硬链接和链接指向的文件在大小汇总中只计一次");
+    
+    oneFileSystemCheckBox = new QCheckBox("只扫描一个文件系统");
+    oneFileSystemCheckBox->setToolTip("不进入挂载在其下的其他文件系统（/proc、网络共享、快照等），"
+                                      "挂载点只显示名称");
+    
+    browseArchivesCheckBox = new QCheckBox("浏览压缩包内容");
+    browseArchivesCheckBox->setToolTip("把 zip、tar 和 tar.gz 文件当作目录展开，只读取目录结构，不解压文件；"
+                                       "压缩包的大小仍按文件本身计算");
+    
     displayLayout->addWidget(showFilesCheckBox);
     displayLayout->addWidget(showHiddenCheckBox);
+    displayLayout->addWidget(followSymlinksCheckBox);
+    displayLayout->addWidget(oneFileSystemCheckBox);
+    displayLayout->addWidget(browseArchivesCheckBox);
     
     // 添加到基本选项布局
     basicLayout->addWidget(indentGroup);
@@ -137,13 +154,23 @@ OptionsDialog::OptionsDialog(const QString &currentIndent, int currentDepth,
     sortTypeComboBox->addItem("文件夹优先", static_cast<int>(SortType::DIRS_FIRST));
     sortTypeComboBox->addItem("文件优先", static_cast<int>(SortType::FILES_FIRST));
     sortTypeComboBox->addItem("按名称", static_cast<int>(SortType::NAME));
+    sortTypeComboBox->addItem("按名称（数字按大小）", static_cast<int>(SortType::NATURAL));
     sortTypeComboBox->addItem("按修改时间", static_cast<int>(SortType::MODIFIED_TIME));
+    sortTypeComboBox->addItem("按大小", static_cast<int>(SortType::SIZE));
+    sortTypeComboBox->addItem("按项目数", static_cast<int>(SortType::ENTRY_COUNT));
     
     QLabel *sortLabel = new QLabel("排序方式:");
     sortLabel->setStyleSheet("font-weight: bold;");
     
     sortLayout->addRow(sortLabel, sortTypeComboBox);
     
+    // 文本输出中显示的大小，按大小排序时也比较这一项
+    sizeModeComboBox = new QComboBox;
+    sizeModeComboBox->addItem("不显示", static_cast<int>(SizeMode::NONE));
+    sizeModeComboBox->addItem("文件大小", static_cast<int>(SizeMode::APPARENT));
+    sizeModeComboBox->addItem("占用空间（同 du）", static_cast<int>(SizeMode::ALLOCATED));
+    sortLayout->addRow("显示大小:", sizeModeComboBox);
+    
     // 输出格式选项
     QGroupBox *formatGroup = new QGroupBox("输出格式");
     QFormLayout *formatLayout = new QFormLayout(formatGroup);
@@ -160,9 +187,79 @@ OptionsDialog::OptionsDialog(const QString &currentIndent, int currentDepth,
     
     formatLayout->addRow(formatLabel, outputFormatComboBox);
     
+    // 性能选项
+    QGroupBox *performanceGroup = new QGroupBox("性能选项");
+    QFormLayout *performanceLayout = new QFormLayout(performanceGroup);
+    performanceLayout->setContentsMargins(15, 15, 15, 15);
+    performanceLayout->setSpacing(10);
+    performanceLayout->setFieldGrowthPolicy(QFormLayout::ExpandingFieldsGrow);
+    
+    threadCountSpinBox = new QSpinBox;
+    threadCountSpinBox->setRange(1, 256);
+    threadCountSpinBox->setValue(QThread::idealThreadCount());
+    threadCountSpinBox->setToolTip("并行扫描子目录的线程数，设为1时单线程扫描");
+    
+    QLabel *threadCountLabel = new QLabel("扫描线程数:");
+    threadCountLabel->setStyleSheet("font-weight: bold;");
+    
+    performanceLayout->addRow(threadCountLabel, threadCountSpinBox);
+    
+    scannerBackendComboBox = new QComboBox;
+    scannerBackendComboBox->addItem("QDir（跨平台）", static_cast<int>(ScannerBackend::QDIR));
+    if (FileSystemBackend::isAvailable(ScannerBackend::NATIVE)) {
+        scannerBackendComboBox->addItem("原生 getdents64（Linux）", static_cast<int>(ScannerBackend::NATIVE));
+    }
+    scannerBackendComboBox->setToolTip("原生后端用 getdents64 批量读取目录项，再用 statx 获取大小和修改时间，比 Qt 后端的开销小");
+    
+    QLabel *scannerBackendLabel = new QLabel("扫描后端:");
+    scannerBackendLabel->setStyleSheet("font-weight: bold;");
+    
+    performanceLayout->addRow(scannerBackendLabel, scannerBackendComboBox);
+    
+    ioUringCheckBox = new QCheckBox("使用 io_uring 批量获取元数据");
+    ioUringCheckBox->setToolTip("扫描每个目录时一次提交全部条目的 statx 请求；不可用时自动回退为逐项 stat");
+    ioUringCheckBox->setChecked(IoUringStatx::isSupported());
+    ioUringCheckBox->setEnabled(IoUringStatx::isSupported());
+    
+    // io_uring 只用于原生后端
+    auto updateIoUringState = [this]() {
+        bool native = getScannerBackend() == ScannerBackend::NATIVE;
+        ioUringCheckBox->setEnabled(native && IoUringStatx::isSupported());
+    };
+    connect(scannerBackendComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, updateIoUringState);
+    updateIoUringState();
+    
+    performanceLayout->addRow(ioUringCheckBox);
+    
+    persistentCacheCheckBox = new QCheckBox("保存扫描结果到磁盘缓存");
+    persistentCacheCheckBox->setToolTip("重新打开书签或历史目录时只重新读取修改过的目录；点击刷新会完整重新扫描");
+    persistentCacheCheckBox->setChecked(true);
+    
+    performanceLayout->addRow(persistentCacheCheckBox);
+    
+    memoryBudgetSpinBox = new QSpinBox;
+    memoryBudgetSpinBox->setRange(0, 1024 * 1024);
+    memoryBudgetSpinBox->setSingleStep(256);
+    memoryBudgetSpinBox->setSuffix(" MB");
+    memoryBudgetSpinBox->setSpecialValueText("不限");
+    memoryBudgetSpinBox->setValue(int(DirectoryTree::defaultMemoryBudget() >> 20));
+    memoryBudgetSpinBox->setToolTip("目录树、缓存和视图共同使用的内存上限。达到上限时先淘汰缓存的树（有磁盘快照的下次直接载入），"
+                                    "扫描中的新目录只统计总大小，其中的条目在层级视图中展开时再读取");
+    
+    QLabel *memoryBudgetLabel = new QLabel("内存上限:");
+    memoryBudgetLabel->setStyleSheet("font-weight: bold;");
+    
+    performanceLayout->addRow(memoryBudgetLabel, memoryBudgetSpinBox);
+    
+    profileCheckBox = new QCheckBox("记录扫描各阶段的耗时（性能分析）");
+    profileCheckBox->setToolTip("扫描后在状态栏显示各阶段耗时，可在导出菜单中查看完整摘要或导出 Chrome/Perfetto 跟踪文件");
+    
+    performanceLayout->addRow(profileCheckBox);
+    
     // 添加到高级选项布局
     advancedLayout->addWidget(sortGroup);
     advancedLayout->addWidget(formatGroup);
+    advancedLayout->addWidget(performanceGroup);
     advancedLayout->addStretch();
     
     // ----- 忽略模式标签页 -----
@@ -306,4 +403,110 @@ SortType OptionsDialog::getSortType() const
 OutputFormat OptionsDialog::getOutputFormat() const
 {
     return static_cast<OutputFormat>(outputFormatComboBox->currentData().toInt());
+}
+
+void OptionsDialog::setThreadCount(int count)
+{
+    threadCountSpinBox->setValue(count);
+}
+
+int OptionsDialog::getThreadCount() const
+{
+    return threadCountSpinBox->value();
+}
+
+void OptionsDialog::setScannerBackend(ScannerBackend type)
+{
+    int index = scannerBackendComboBox->findData(static_cast<int>(type));
+    if (index >= 0) {
+        scannerBackendComboBox->setCurrentIndex(index);
+    }
+}
+
+ScannerBackend OptionsDialog::getScannerBackend() const
+{
+    return static_cast<ScannerBackend>(scannerBackendComboBox->currentData().toInt());
+}
+
+void OptionsDialog::setUseIoUring(bool enable)
+{
+    ioUringCheckBox->setChecked(enable && IoUringStatx::isSupported());
+}
+
+bool OptionsDialog::getUseIoUring() const
+{
+    return ioUringCheckBox->isChecked();
+}
+
+void OptionsDialog::setUsePersistentCache(bool enable)
+{
+    persistentCacheCheckBox->setChecked(enable);
+}
+
+bool OptionsDialog::getUsePersistentCache() const
+{
+    return persistentCacheCheckBox->isChecked();
+}
+
+void OptionsDialog::setSizeMode(SizeMode mode)
+{
+    int index = sizeModeComboBox->findData(static_cast<int>(mode));
+    if (index >= 0) {
+        sizeModeComboBox->setCurrentIndex(index);
+    }
+}
+
+SizeMode OptionsDialog::getSizeMode() const
+{
+    return static_cast<SizeMode>(sizeModeComboBox->currentData().toInt());
+}
+
+void OptionsDialog::setFollowSymlinks(bool follow)
+{
+    followSymlinksCheckBox->setChecked(follow);
+}
+
+bool OptionsDialog::getFollowSymlinks() const
+{
+    return followSymlinksCheckBox->isChecked();
+}
+
+void OptionsDialog::setOneFileSystem(bool enable)
+{
+    oneFileSystemCheckBox->setChecked(enable);
+}
+
+bool OptionsDialog::getOneFileSystem() const
+{
+    return oneFileSystemCheckBox->isChecked();
+}
+
+void OptionsDialog::setBrowseArchives(bool enable)
+{
+    browseArchivesCheckBox->setChecked(enable);
+}
+
+bool OptionsDialog::getBrowseArchives() const
+{
+    return browseArchivesCheckBox->isChecked();
+}
+
+void OptionsDialog::setProfileScans(bool enable)
+{
+    profileCheckBox->setChecked(enable);
+}
+
+bool OptionsDialog::getProfileScans() const
+{
+    return profileCheckBox->isChecked();
+}
+
+void OptionsDialog::setMemoryBudget(qint64 bytes)
+{
+    memoryBudgetSpinBox->setValue(int(bytes >> 20));
+}
+
+qint64 OptionsDialog::getMemoryBudget() const
+{
+    return qint64(memoryBudgetSpinBox->value()) << 20;
 } 
\ No newline at end of file
@@ -28,6 +28,28 @@ public:
     QStringList getIgnorePatterns() const;
     SortType getSortType() const;
     OutputFormat getOutputFormat() const;
+    
+    void setThreadCount(int count);
+    int getThreadCount() const;
+    void setScannerBackend(ScannerBackend type);
+    ScannerBackend getScannerBackend() const;
+    void setUseIoUring(bool enable);
+    bool getUseIoUring() const;
+    void setUsePersistentCache(bool enable);
+    bool getUsePersistentCache() const;
+    void setSizeMode(SizeMode mode);
+    SizeMode getSizeMode() const;
+    void setFollowSymlinks(bool follow);
+    bool getFollowSymlinks() const;
+    void setOneFileSystem(bool enable);
+    bool getOneFileSystem() const;
+    void setBrowseArchives(bool enable);
+    bool getBrowseArchives() const;
+    void setProfileScans(bool enable);
+    bool getProfileScans() const;
+    // 字节数，0 表示不限
+    void setMemoryBudget(qint64 bytes);
+    qint64 getMemoryBudget() const;
 
 private slots:
     void addIgnorePattern();
@@ -41,10 +63,20 @@ private:
     QSpinBox *depthSpinBox;
     QCheckBox *showFilesCheckBox;
     QCheckBox *showHiddenCheckBox;
+    QCheckBox *followSymlinksCheckBox;
+    QCheckBox *oneFileSystemCheckBox;
+    QCheckBox *browseArchivesCheckBox;
     
     // 高级选项标签页
     QComboBox *sortTypeComboBox;
+    QComboBox *sizeModeComboBox;
     QComboBox *outputFormatComboBox;
+    QSpinBox *threadCountSpinBox;
+    QComboBox *scannerBackendComboBox;
+    QCheckBox *ioUringCheckBox;
+    QCheckBox *persistentCacheCheckBox;
+    QCheckBox *profileCheckBox;
+    QSpinBox *memoryBudgetSpinBox;
     
     // 忽略模式标签页
     QLineEdit *ignorePatternEdit;
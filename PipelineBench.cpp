@@ -0,0 +1,453 @@
+// 整条处理流程的基准：在临时目录中生成可重现的合成目录树，分别计时扫描、忽略模式匹配、
+// 投影排序、文本/Markdown/JSON 渲染和层级模型遍历，以 JSON 输出每一阶段的 ns/条目和内存分配次数，
+// 便于对比不同版本。用法：PipelineBench [--scale 0.1] [--repeat 3] [--label v1.2] [-o result.json]
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include "DirectoryTree.h"
+#include "DirectoryTreeModel.h"
+#include "IgnoreMatcher.h"
+
+// 统计内存分配：operator new 在所有平台上都计入；glibc 上再替换 malloc 系列，
+// QString、QVector 等 Qt 容器的分配也能算进去
+namespace {
+std::atomic<qint64> allocationCount(0);
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+}
+
+// operator new 最终调用上面的 malloc，不必重复计数
+#else
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+#endif
+
+namespace {
+
+// 丢弃所有写入的设备，渲染阶段只计算生成输出的开销
+class NullDevice : public QIODevice
+{
+public:
+    NullDevice() { open(QIODevice::WriteOnly); }
+
+protected:
+    qint64 readData(char *, qint64) override { return -1; }
+    qint64 writeData(const char *, qint64 length) override { return length; }
+};
+
+// 生成合成目录树。名称只由编号决定，不使用随机数，每次生成的结果完全相同
+class TreeGenerator
+{
+public:
+    explicit TreeGenerator(const QString &root) : root(root) {}
+
+    bool makeDir(const QString &relative)
+    {
+        return QDir().mkpath(root + "/" + relative);
+    }
+
+    bool touch(const QString &relative)
+    {
+        QFile file(root + "/" + relative);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+        ++files;
+        return true;
+    }
+
+    int files = 0;
+
+private:
+    QString root;
+};
+
+QString fileName(int index)
+{
+    static const char *stems[] = { "main", "util", "config", "README", "data", "index", "module", "test" };
+    static const char *extensions[] = { ".cpp", ".h", ".txt", ".json", ".md", ".py", "" };
+    return QString("%1_%2%3").arg(stems[index % 8]).arg(index).arg(extensions[(index / 8) % 7]);
+}
+
+// 深而窄：每层一个子目录和少量文件
+bool generateDeep(TreeGenerator &gen, double scale)
+{
+    int depth = qBound(10, int(200 * scale), 200);
+    QString path = "deep";
+    for (int level = 0; level < depth; ++level) {
+        path += QString("/level_%1").arg(level);
+        if (!gen.makeDir(path)) {
+            return false;
+        }
+        for (int i = 0; i < 20; ++i) {
+            if (!gen.touch(path + "/" + fileName(i))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 宽而平：一个目录下的大量文件
+bool generateWide(TreeGenerator &gen, double scale)
+{
+    int count = qMax(1000, int(200000 * scale));
+    if (!gen.makeDir("wide")) {
+        return false;
+    }
+    for (int i = 0; i < count; ++i) {
+        if (!gen.touch("wide/" + fileName(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 百万文件：两层目录，每个叶子目录一千个文件
+bool generateMillion(TreeGenerator &gen, double scale)
+{
+    int leaves = qMax(10, int(1000 * scale));
+    for (int leaf = 0; leaf < leaves; ++leaf) {
+        QString dir = QString("million/group_%1/leaf_%2").arg(leaf / 100).arg(leaf);
+        if (!gen.makeDir(dir)) {
+            return false;
+        }
+        for (int i = 0; i < 1000; ++i) {
+            if (!gen.touch(dir + "/" + fileName(i))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 长名称：接近文件系统上限的名称，考验字符串池、排序键和渲染
+bool generateLongNames(TreeGenerator &gen, double scale)
+{
+    int dirs = qMax(5, int(100 * scale));
+    for (int d = 0; d < dirs; ++d) {
+        QString dir = QString("long/%1_%2").arg(QString(120, QChar('d'))).arg(d);
+        if (!gen.makeDir(dir)) {
+            return false;
+        }
+        for (int i = 0; i < 200; ++i) {
+            if (!gen.touch(dir + "/" + QString(200, QChar('f')) + fileName(i))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 大量被忽略的内容：每个项目都带 node_modules、build 和编译产物
+bool generateIgnored(TreeGenerator &gen, double scale)
+{
+    int projects = qMax(10, int(200 * scale));
+    for (int p = 0; p < projects; ++p) {
+        QString project = QString("ignored/project_%1").arg(p);
+        if (!gen.makeDir(project + "/src") || !gen.makeDir(project + "/build")) {
+            return false;
+        }
+        for (int i = 0; i < 50; ++i) {
+            if (!gen.touch(project + "/src/" + fileName(i)) || !gen.touch(project + QString("/src/obj_%1.o").arg(i))) {
+                return false;
+            }
+        }
+        for (int i = 0; i < 100; ++i) {
+            if (!gen.touch(project + QString("/build/unit_%1.o").arg(i))) {
+                return false;
+            }
+        }
+        for (int m = 0; m < 20; ++m) {
+            QString module = project + QString("/node_modules/package_%1").arg(m);
+            if (!gen.makeDir(module)) {
+                return false;
+            }
+            for (int i = 0; i < 10; ++i) {
+                if (!gen.touch(module + "/" + fileName(i))) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+struct Variant {
+    const char *name;
+    std::function<bool(TreeGenerator &, double)> generate;
+    QStringList ignorePatterns;
+};
+
+// 重复 repeat 次取最快的一次；分配次数取同一次的值
+QJsonObject measure(const QString &stage, qint64 entries, int repeat, const std::function<void()> &body)
+{
+    qint64 bestNs = -1;
+    qint64 allocations = 0;
+    for (int i = 0; i < repeat; ++i) {
+        qint64 allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+        QElapsedTimer timer;
+        timer.start();
+        body();
+        qint64 ns = timer.nsecsElapsed();
+        qint64 allocated = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+        if (bestNs < 0 || ns < bestNs) {
+            bestNs = ns;
+            allocations = allocated;
+        }
+    }
+
+    QJsonObject result;
+    result["stage"] = stage;
+    result["ms"] = double(bestNs) / 1e6;
+    result["nsPerEntry"] = entries > 0 ? double(bestNs) / double(entries) : 0.0;
+    result["allocations"] = double(allocations);
+    result["allocationsPerEntry"] = entries > 0 ? double(allocations) / double(entries) : 0.0;
+    return result;
+}
+
+// 按层级视图的方式遍历模型：逐层取索引、行数和显示的文字
+int walkModel(const DirectoryTreeModel &model, const QModelIndex &parent)
+{
+    int visited = 0;
+    int rows = model.rowCount(parent);
+    for (int row = 0; row < rows; ++row) {
+        QModelIndex index = model.index(row, DirectoryTreeModel::NameColumn, parent);
+        model.data(index, Qt::DisplayRole);
+        model.data(model.index(row, DirectoryTreeModel::SizeColumn, parent), Qt::DisplayRole);
+        ++visited;
+        if (model.hasChildren(index)) {
+            visited += walkModel(model, index);
+        }
+    }
+    return visited;
+}
+
+QJsonObject runVariant(const Variant &variant, const QString &root, int repeat)
+{
+    DirectoryTree tree;
+    tree.setIgnorePatterns(variant.ignorePatterns);
+
+    std::shared_ptr<ScannedTree> source;
+    QJsonArray stages;
+
+    // 扫描时文件系统缓存已热，测的是遍历和建树本身，不含磁盘寻道
+    QJsonObject scanStage = measure("scan", 0, repeat, [&]() { source = tree.scanSource(root); });
+    const qint64 entries = source->nodes.size();
+    scanStage["nsPerEntry"] = scanStage["ms"].toDouble() * 1e6 / double(entries);
+    scanStage["allocationsPerEntry"] = scanStage["allocations"].toDouble() / double(entries);
+    stages.append(scanStage);
+
+    // 扫描时的 shouldIgnore 即 IgnoreMatcher::matches，对树中的每个名称各匹配一次
+    QStringList names;
+    names.reserve(int(entries));
+    for (NodeId id = 0; id < NodeId(entries); ++id) {
+        names.append(source->nodes.name(id));
+    }
+    IgnoreMatcher matcher;
+    matcher.setPatterns(variant.ignorePatterns.isEmpty() ? QStringList{ "node_modules", "build", "*.o", "*.tmp" }
+                                                         : variant.ignorePatterns);
+    int matched = 0;
+    stages.append(measure("ignore", entries, repeat, [&]() {
+        matched = 0;
+        for (const QString &name : names) {
+            matched += matcher.matches(name) ? 1 : 0;
+        }
+    }));
+
+    // 排序发生在投影阶段（按当前选项从超集树生成结果），每种排序方式单独计时
+    static const struct {
+        const char *name;
+        SortType type;
+    } sorts[] = {
+        { "project/name", SortType::NAME },
+        { "project/natural", SortType::NATURAL },
+        { "project/dirs-first", SortType::DIRS_FIRST },
+        { "project/modified-time", SortType::MODIFIED_TIME },
+        { "project/size", SortType::SIZE },
+    };
+    std::shared_ptr<ScannedTree> projected;
+    for (const auto &sort : sorts) {
+        tree.setSortType(sort.type);
+        stages.append(measure(sort.name, entries, repeat, [&]() { projected = tree.project(*source); }));
+    }
+    tree.setSortType(SortType::DIRS_FIRST);
+    projected = tree.project(*source);
+    const qint64 projectedEntries = projected->nodes.size();
+
+    stages.append(measure("render/text", projectedEntries, repeat, [&]() {
+        NullDevice device;
+        QTextStream out(&device);
+        tree.setOutputFormat(OutputFormat::TEXT);
+        tree.renderTree(*projected, out);
+        out.flush();
+    }));
+    stages.append(measure("render/markdown", projectedEntries, repeat, [&]() {
+        NullDevice device;
+        QTextStream out(&device);
+        tree.setOutputFormat(OutputFormat::MARKDOWN);
+        tree.renderTree(*projected, out);
+        out.flush();
+    }));
+    stages.append(measure("render/json", projectedEntries, repeat, [&]() {
+        NullDevice device;
+        tree.writeJsonTree(*projected, &device);
+    }));
+    stages.append(measure("render/ndjson", projectedEntries, repeat, [&]() {
+        NullDevice device;
+        tree.writeNdjsonTree(*projected, &device);
+    }));
+
+    stages.append(measure("model", projectedEntries, repeat, [&]() {
+        DirectoryTreeModel model;
+        model.setTree(projected, &tree);
+        walkModel(model, QModelIndex());
+    }));
+
+    QJsonObject result;
+    result["variant"] = QString(variant.name);
+    result["entries"] = double(entries);
+    result["projectedEntries"] = double(projectedEntries);
+    result["ignoredMatches"] = matched;
+    result["stages"] = stages;
+    return result;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption scaleOption("scale", "合成目录树的规模系数（默认 1，百万文件变体约 100 万个文件）", "factor", "1");
+    QCommandLineOption repeatOption("repeat", "每个阶段重复次数，取最快的一次（默认 3）", "n", "3");
+    QCommandLineOption labelOption("label", "写入结果的标签，例如版本号", "label");
+    QCommandLineOption outputOption({ "o", "output" }, "结果写入文件而不是标准输出", "file");
+    QCommandLineOption variantOption("variant", "只运行指定的变体，可多次指定", "name");
+    parser.addOptions({ scaleOption, repeatOption, labelOption, outputOption, variantOption });
+    parser.process(app);
+
+    const double scale = qMax(0.001, parser.value(scaleOption).toDouble());
+    const int repeat = qMax(1, parser.value(repeatOption).toInt());
+    const QStringList onlyVariants = parser.values(variantOption);
+
+    const std::vector<Variant> variants = {
+        { "deep", generateDeep, {} },
+        { "wide", generateWide, {} },
+        { "million", generateMillion, {} },
+        { "long-names", generateLongNames, {} },
+        { "many-ignored", generateIgnored, { "node_modules", "build", "*.o" } },
+    };
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        err << "cannot create temporary directory\n";
+        return 1;
+    }
+
+    QJsonArray results;
+    for (const Variant &variant : variants) {
+        if (!onlyVariants.isEmpty() && !onlyVariants.contains(variant.name)) {
+            continue;
+        }
+        TreeGenerator generator(workDir.path());
+        err << "generating " << variant.name << "...\n";
+        err.flush();
+        if (!variant.generate(generator, scale)) {
+            err << "failed to generate " << variant.name << "\n";
+            return 1;
+        }
+        err << "measuring " << variant.name << " (" << generator.files << " files)\n";
+        err.flush();
+
+        QString root = workDir.path() + "/" + variant.name;
+        QJsonObject result = runVariant(variant, root, repeat);
+        result["files"] = generator.files;
+        results.append(result);
+
+        // 每个变体测完就删除，临时目录中不会同时存在所有的树
+        QDir(root).removeRecursively();
+    }
+
+    QJsonObject report;
+    report["label"] = parser.value(labelOption);
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["qtVersion"] = QString(qVersion());
+    report["threads"] = QThread::idealThreadCount();
+    report["scale"] = scale;
+    report["repeat"] = repeat;
+#if defined(__GLIBC__)
+    report["allocationCounter"] = QString("malloc");
+#else
+    report["allocationCounter"] = QString("operator new");
+#endif
+    report["results"] = results;
+
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            err << "cannot write " << parser.value(outputOption) << "\n";
+            return 1;
+        }
+    } else {
+        fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    }
+    return 0;
+}
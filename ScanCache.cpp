@@ -0,0 +1,153 @@
+#include "ScanCache.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = { 'D', 'T', 'V', 'S', 'C', 'A', 'N', '\0' };
+const quint32 SNAPSHOT_VERSION = 3;  // 2：保存超集树，节点带隐藏标记；3：增加大小和条目数
+const quint32 BYTE_ORDER_MARK = 0x01020304;  // 快照按本机字节序写出，换了字节序的机器直接视为未命中
+const char SNAPSHOT_SUFFIX[] = ".dtvscan";
+
+struct SnapshotHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrderMark;
+    quint32 root;
+    quint32 complete;
+    qint64 scanStartedAt;
+    qint64 scannedItems;
+    quint32 rootPathBytes;
+    quint32 scanKeyBytes;
+};
+
+}
+
+ScanCache::ScanCache()
+    : ScanCache(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+                + "/DirectoryTreeViewer/scans")
+{
+}
+
+ScanCache::ScanCache(const QString &directory)
+    : cacheDirectory(directory)
+{
+}
+
+QString ScanCache::snapshotPath(const QString &rootPath) const
+{
+    QByteArray hash = QCryptographicHash::hash(rootPath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return cacheDirectory + "/" + QString::fromLatin1(hash) + SNAPSHOT_SUFFIX;
+}
+
+std::shared_ptr<ScannedTree> ScanCache::load(const QString &rootPath, const QString &scanKey) const
+{
+    QFile file(snapshotPath(rootPath));
+    if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(SnapshotHeader))) {
+        return nullptr;
+    }
+
+    // 映射整个文件，各个数组直接从映射区复制，不经过逐项解析
+    const uchar *mapped = file.map(0, file.size());
+    if (!mapped) {
+        return nullptr;
+    }
+    const char *data = reinterpret_cast<const char *>(mapped);
+    const char *end = data + file.size();
+
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    data += sizeof(header);
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.version != SNAPSHOT_VERSION
+            || header.byteOrderMark != BYTE_ORDER_MARK
+            || qint64(header.rootPathBytes) + header.scanKeyBytes > end - data) {
+        return nullptr;
+    }
+
+    // 文件名只是根路径的散列，还要核对根路径和扫描选项本身
+    QString storedRoot = QString::fromUtf8(data, int(header.rootPathBytes));
+    data += header.rootPathBytes;
+    QString storedKey = QString::fromUtf8(data, int(header.scanKeyBytes));
+    data += header.scanKeyBytes;
+    if (storedRoot != rootPath || storedKey != scanKey) {
+        return nullptr;
+    }
+
+    auto tree = std::make_shared<ScannedTree>();
+    tree->rootPath = storedRoot;
+    tree->scanKey = storedKey;
+    tree->root = header.root;
+    tree->complete = header.complete != 0;
+    tree->scanStartedAt = header.scanStartedAt;
+    tree->scannedItems = header.scannedItems;
+    if (!tree->nodes.load(data, end) || tree->root != 0) {
+        return nullptr;
+    }
+    return tree;
+}
+
+bool ScanCache::save(const ScannedTree &tree) const
+{
+    if (!QDir().mkpath(cacheDirectory)) {
+        return false;
+    }
+
+    QSaveFile file(snapshotPath(tree.rootPath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    const QByteArray rootPath = tree.rootPath.toUtf8();
+    const QByteArray scanKey = tree.scanKey.toUtf8();
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.root = tree.root;
+    header.complete = tree.complete ? 1 : 0;
+    header.scanStartedAt = tree.scanStartedAt;
+    header.scannedItems = tree.scannedItems;
+    header.rootPathBytes = quint32(rootPath.size());
+    header.scanKeyBytes = quint32(scanKey.size());
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(rootPath);
+    file.write(scanKey);
+    if (!tree.nodes.save(&file) || !file.commit()) {
+        return false;
+    }
+
+    prune();
+    return true;
+}
+
+void ScanCache::remove(const QString &rootPath) const
+{
+    QFile::remove(snapshotPath(rootPath));
+}
+
+void ScanCache::clear() const
+{
+    QDir dir(cacheDirectory);
+    const QStringList files = dir.entryList({ QString("*") + SNAPSHOT_SUFFIX }, QDir::Files);
+    for (const QString &name : files) {
+        dir.remove(name);
+    }
+}
+
+void ScanCache::prune() const
+{
+    // 只保留最近写入的若干份快照
+    QDir dir(cacheDirectory);
+    const QFileInfoList files = dir.entryInfoList({ QString("*") + SNAPSHOT_SUFFIX }, QDir::Files, QDir::Time);
+    for (int i = maxSnapshots; i < files.size(); ++i) {
+        QFile::remove(files.at(i).absoluteFilePath());
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef SCANCACHE_H
+#define SCANCACHE_H
+
+#include <QString>
+#include <memory>
+#include "DirectoryTree.h"
+
+// 扫描结果的磁盘缓存。每个根目录保存一份二进制快照（文件头 + NodeStore 的原始数组），
+// 读取时通过内存映射整块复制，重新打开书签或历史记录时无需冷扫描，
+// 再由 DirectoryTree::revalidate 按目录修改时间只重新读取有变化的目录。
+// 所有方法只做文件读写，可以在扫描线程中调用
+class ScanCache
+{
+public:
+    ScanCache();
+    explicit ScanCache(const QString &directory);
+
+    // 快照保存的是超集树，scanKey 应为 DirectoryTree::sourceKey。
+    // 根路径或扫描选项与快照不一致、文件损坏时返回空
+    std::shared_ptr<ScannedTree> load(const QString &rootPath, const QString &scanKey) const;
+    // 只应保存完整扫描的超集树；写入临时文件后原子替换
+    bool save(const ScannedTree &tree) const;
+    void remove(const QString &rootPath) const;
+    void clear() const;
+
+    QString directory() const { return cacheDirectory; }
+
+private:
+    QString cacheDirectory;
+    int maxSnapshots = 16;
+
+    QString snapshotPath(const QString &rootPath) const;
+    void prune() const;
+};
+
+#endif // SCANCACHE_H
@@ -0,0 +1,314 @@
+#include "ScanProfiler.h"
+#include <QLocale>
+#include <QStringList>
+#include <algorithm>
+
+namespace {
+
+const qint64 LATENCY_LIMITS_MS[ScanProfiler::LATENCY_BUCKETS - 1] = { 1, 10, 100, 1000, 10000 };
+
+const char *const PHASE_KEYS[int(ProfilePhase::COUNT)] = {
+    "scan", "directory", "list", "stat", "strings", "sort", "filter", "build", "project", "render", "view"
+};
+
+void appendJsonString(QByteArray &out, const QByteArray &utf8)
+{
+    out += '"';
+    for (char ch : utf8) {
+        uchar c = uchar(ch);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (c < 0x20) {
+            out += QByteArray("\\u00") + QByteArray::number(c, 16).rightJustified(2, '0');
+        } else {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+QString formatMs(qint64 ns)
+{
+    return QLocale().toString(double(ns) / 1e6, 'f', 1) + " ms";
+}
+
+}
+
+std::atomic<bool> ScanProfiler::enabledFlag(false);
+
+ScanProfiler &ScanProfiler::instance()
+{
+    static ScanProfiler profiler;
+    return profiler;
+}
+
+ScanProfiler::ScanProfiler()
+    : slowThresholdNs(0), epochNs(now())
+{
+    for (int i = 0; i < int(ProfilePhase::COUNT); ++i) {
+        phaseNs[i] = 0;
+        phaseCounts[i] = 0;
+        phaseItems[i] = 0;
+    }
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        latencyCounts[i] = 0;
+    }
+}
+
+void ScanProfiler::setEnabled(bool enable)
+{
+    enabledFlag.store(enable, std::memory_order_relaxed);
+}
+
+void ScanProfiler::reset()
+{
+    for (int i = 0; i < int(ProfilePhase::COUNT); ++i) {
+        phaseNs[i] = 0;
+        phaseCounts[i] = 0;
+        phaseItems[i] = 0;
+    }
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        latencyCounts[i] = 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(slowMutex);
+        slowest.clear();
+        slowThresholdNs = 0;
+    }
+
+    // 线程缓冲区不释放（其他线程可能仍持有指针），只清空内容
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (const auto &buffer : buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->events.clear();
+        buffer->details.clear();
+        buffer->dropped = 0;
+    }
+    epochNs = now();
+}
+
+ScanProfiler::ThreadBuffer *ScanProfiler::currentBuffer()
+{
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = buffers.back().get();
+        buffer->threadId = int(buffers.size());
+    }
+    return buffer;
+}
+
+void ScanProfiler::addEvent(ProfilePhase phase, qint64 startNs, qint64 durationNs, qint64 items, const QString *detail)
+{
+    ThreadBuffer *buffer = currentBuffer();
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    if (buffer->events.size() >= MAX_TRACE_EVENTS_PER_THREAD) {
+        ++buffer->dropped;
+        return;
+    }
+
+    int detailIndex = -1;
+    if (detail) {
+        detailIndex = int(buffer->details.size());
+        buffer->details.push_back(*detail);
+    }
+    buffer->events.push_back({startNs, durationNs, items, phase, detailIndex});
+}
+
+void ScanProfiler::record(ProfilePhase phase, qint64 startNs, qint64 items)
+{
+    qint64 durationNs = now() - startNs;
+    int index = int(phase);
+    phaseNs[index].fetch_add(durationNs, std::memory_order_relaxed);
+    phaseCounts[index].fetch_add(1, std::memory_order_relaxed);
+    phaseItems[index].fetch_add(items, std::memory_order_relaxed);
+
+    if (durationNs >= MIN_TRACE_DURATION_NS) {
+        addEvent(phase, startNs, durationNs, items, nullptr);
+    }
+}
+
+void ScanProfiler::recordDirectory(const QString &path, qint64 startNs, int entries)
+{
+    qint64 durationNs = now() - startNs;
+    int index = int(ProfilePhase::DIRECTORY);
+    phaseNs[index].fetch_add(durationNs, std::memory_order_relaxed);
+    phaseCounts[index].fetch_add(1, std::memory_order_relaxed);
+    phaseItems[index].fetch_add(entries, std::memory_order_relaxed);
+
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && durationNs >= LATENCY_LIMITS_MS[bucket] * 1000000) {
+        ++bucket;
+    }
+    latencyCounts[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    // 绝大多数目录比列表中最快的一项还快，无需加锁
+    if (durationNs > slowThresholdNs.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(slowMutex);
+        slowest.append({path, durationNs, entries});
+        std::sort(slowest.begin(), slowest.end(), [](const SlowDirectory &a, const SlowDirectory &b) {
+            return a.durationNs > b.durationNs;
+        });
+        if (slowest.size() > SLOW_DIRECTORY_COUNT) {
+            slowest.resize(SLOW_DIRECTORY_COUNT);
+            slowThresholdNs = slowest.last().durationNs;
+        }
+    }
+
+    if (durationNs >= MIN_TRACE_DURATION_NS) {
+        addEvent(ProfilePhase::DIRECTORY, startNs, durationNs, entries, &path);
+    }
+}
+
+ScanProfiler::PhaseTotals ScanProfiler::totals(ProfilePhase phase) const
+{
+    int index = int(phase);
+    PhaseTotals result;
+    result.totalNs = phaseNs[index].load(std::memory_order_relaxed);
+    result.count = phaseCounts[index].load(std::memory_order_relaxed);
+    result.items = phaseItems[index].load(std::memory_order_relaxed);
+    return result;
+}
+
+QVector<ScanProfiler::SlowDirectory> ScanProfiler::slowestDirectories() const
+{
+    std::lock_guard<std::mutex> lock(slowMutex);
+    return slowest;
+}
+
+QString ScanProfiler::phaseName(ProfilePhase phase)
+{
+    switch (phase) {
+        case ProfilePhase::SCAN:      return "扫描";
+        case ProfilePhase::DIRECTORY: return "读取目录";
+        case ProfilePhase::LIST:      return "列出条目";
+        case ProfilePhase::STAT:      return "获取元数据";
+        case ProfilePhase::STRINGS:   return "生成名称";
+        case ProfilePhase::SORT:      return "排序";
+        case ProfilePhase::FILTER:    return "忽略和过滤";
+        case ProfilePhase::BUILD:     return "加入树";
+        case ProfilePhase::PROJECT:   return "投影";
+        case ProfilePhase::RENDER:    return "渲染";
+        case ProfilePhase::VIEW:      return "填充视图";
+        case ProfilePhase::COUNT:     break;
+    }
+    return QString();
+}
+
+QString ScanProfiler::shortSummary() const
+{
+    // 多线程扫描时各阶段是所有线程的累计耗时，可能超过墙钟时间
+    static const ProfilePhase phases[] = {
+        ProfilePhase::LIST, ProfilePhase::STAT, ProfilePhase::STRINGS, ProfilePhase::SORT,
+        ProfilePhase::FILTER, ProfilePhase::BUILD, ProfilePhase::PROJECT, ProfilePhase::VIEW
+    };
+    QStringList parts;
+    for (ProfilePhase phase : phases) {
+        PhaseTotals t = totals(phase);
+        if (t.count > 0) {
+            parts << phaseName(phase) + " " + formatMs(t.totalNs);
+        }
+    }
+    return parts.join(" · ");
+}
+
+QString ScanProfiler::summary() const
+{
+    QString text;
+    PhaseTotals scan = totals(ProfilePhase::SCAN);
+    text += QString("扫描总耗时：%1（%2 次）\n").arg(formatMs(scan.totalNs)).arg(scan.count);
+    text += "各阶段累计耗时（多线程时为所有线程之和）：\n";
+    for (int i = int(ProfilePhase::DIRECTORY); i < int(ProfilePhase::COUNT); ++i) {
+        PhaseTotals t = totals(ProfilePhase(i));
+        if (t.count == 0) {
+            continue;
+        }
+        text += QString("  %1：%2，%3 次").arg(phaseName(ProfilePhase(i)), -6).arg(formatMs(t.totalNs))
+                    .arg(QLocale().toString(t.count));
+        if (t.items > 0) {
+            text += QString("，%1 项，%2 ns/项").arg(QLocale().toString(t.items))
+                        .arg(QLocale().toString(double(t.totalNs) / double(t.items), 'f', 0));
+        }
+        text += '\n';
+    }
+
+    static const char *const bucketNames[LATENCY_BUCKETS] = {
+        "< 1 ms", "1-10 ms", "10-100 ms", "0.1-1 s", "1-10 s", "≥ 10 s"
+    };
+    text += "目录读取延迟分布：\n";
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        text += QString("  %1：%2\n").arg(bucketNames[i], -10).arg(QLocale().toString(latencyBucket(i)));
+    }
+
+    const QVector<SlowDirectory> slow = slowestDirectories();
+    if (!slow.isEmpty()) {
+        text += "最慢的目录：\n";
+        for (const SlowDirectory &dir : slow) {
+            text += QString("  %1  %2（%3 项）\n").arg(formatMs(dir.durationNs), 12).arg(dir.path)
+                        .arg(QLocale().toString(dir.entries));
+        }
+    }
+    return text;
+}
+
+bool ScanProfiler::writeChromeTrace(QIODevice *device, QString *errorString) const
+{
+    QByteArray out;
+    out.reserve(1 << 20);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto flush = [&]() {
+        if (device->write(out) != out.size()) {
+            if (errorString) {
+                *errorString = device->errorString();
+            }
+            return false;
+        }
+        out.clear();
+        return true;
+    };
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    qint64 dropped = 0;
+    for (const auto &buffer : buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        if (buffer->events.empty()) {
+            continue;
+        }
+        dropped += buffer->dropped;
+
+        // 线程名元数据，Perfetto 按它给每条轨道命名
+        if (!first) {
+            out += ",\n";
+        }
+        first = false;
+        out += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + QByteArray::number(buffer->threadId)
+               + ",\"args\":{\"name\":\"thread " + QByteArray::number(buffer->threadId) + "\"}}";
+
+        for (const TraceEvent &event : buffer->events) {
+            out += ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" + QByteArray::number(buffer->threadId) + ",\"name\":";
+            if (event.detail >= 0) {
+                appendJsonString(out, buffer->details[size_t(event.detail)].toUtf8());
+            } else {
+                appendJsonString(out, phaseName(event.phase).toUtf8());
+            }
+            out += ",\"cat\":\"";
+            out += PHASE_KEYS[int(event.phase)];
+            // 时间单位为微秒，保留三位小数即纳秒精度
+            out += "\",\"ts\":" + QByteArray::number(double(event.startNs - epochNs) / 1000.0, 'f', 3)
+                   + ",\"dur\":" + QByteArray::number(double(event.durationNs) / 1000.0, 'f', 3);
+            if (event.items > 0) {
+                out += ",\"args\":{\"items\":" + QByteArray::number(event.items) + "}";
+            }
+            out += '}';
+            if (out.size() >= (1 << 20) && !flush()) {
+                return false;
+            }
+        }
+    }
+
+    out += "\n],\"otherData\":{\"droppedEvents\":" + QByteArray::number(dropped) + "}}\n";
+    return flush();
+}
@@ -0,0 +1,181 @@
+#include "ScanSession.h"
+#include <vector>
+
+namespace {
+
+// 开始后的这段时间内样本太少，不给出剩余时间
+const qint64 ESTIMATE_WARMUP_MS = 1000;
+
+// 按深度估计剩余工作量。读取完深度 d 的目录时它的子目录随即加入深度 d + 1，
+// 因此 m(d) = 深度 d + 1 已发现的目录数 / 深度 d 已读取的目录数 是这一层的平均分支数，只取自已读取的目录。
+// 深度 d 的一个待读目录连同其下的目录预计有 S(d) = 1 + m(d) * S(d + 1) 个，最深一层之下为 0，
+// 各层待读的目录数乘以 S(d) 之和就是剩余的目录数，再按目前的目录速率换算成时间。
+// （不能用全部目录的平均分支数：所有已发现的目录都由已读取的目录发现，还有目录待读时它总是不小于 1）
+void estimateRemaining(ScanProgress &progress)
+{
+    if (progress.elapsedMs <= 0) {
+        return;
+    }
+    progress.entriesPerSecond = progress.entriesSeen * 1000.0 / progress.elapsedMs;
+
+    qint64 pending = progress.dirsDiscovered - progress.dirsCompleted;
+    if (progress.dirsCompleted == 0 || progress.elapsedMs < ESTIMATE_WARMUP_MS) {
+        return;
+    }
+    if (pending <= 0) {
+        progress.remainingMs = 0;
+        progress.percent = 100;
+        return;
+    }
+
+    const std::vector<qint64> &discovered = progress.discoveredByDepth;
+    const std::vector<qint64> &completed = progress.completedByDepth;
+    int levels = int(qMin(discovered.size(), completed.size()));
+    while (levels > 0 && discovered[size_t(levels - 1)] == 0) {
+        --levels;
+    }
+    if (levels == 0) {
+        return;
+    }
+
+    // 最深一层之下还没有发现目录，分支数为 0；最后一项合并了更深的目录，同样不再向下估计
+    std::vector<double> branching(size_t(levels), 0.0);
+    for (int d = 0; d + 1 < levels; ++d) {
+        size_t i = size_t(d);
+        if (completed[i] > 0) {
+            branching[i] = double(discovered[i + 1]) / double(completed[i]);
+        }
+    }
+
+    double remainingDirs = 0.0;
+    double below = 0.0;     // S(d + 1)
+    for (int d = levels - 1; d >= 0; --d) {
+        size_t i = size_t(d);
+        double subtree = 1.0 + branching[i] * below;
+        remainingDirs += double(qMax<qint64>(0, discovered[i] - completed[i])) * subtree;
+        below = subtree;
+    }
+
+    double dirsPerMs = double(progress.dirsCompleted) / double(progress.elapsedMs);
+    progress.remainingMs = qint64(remainingDirs / dirsPerMs);
+    progress.percent = qMin(99, int(100.0 * progress.dirsCompleted / (progress.dirsCompleted + remainingDirs)));
+}
+
+}
+
+ScanSession::ScanSession(QObject *parent)
+    : QObject(parent), worker(nullptr), progressTimer(new QTimer(this))
+{
+    // 进度由 GUI 线程定时读取原子计数器，扫描线程不需要发送任何进度事件
+    progressTimer->setInterval(100);
+    connect(progressTimer, &QTimer::timeout, this, &ScanSession::reportProgress);
+}
+
+ScanSession::~ScanSession()
+{
+    // 通常已由 discard 等到线程退出；只有父对象（主窗口）销毁时才可能在这里等待
+    cancel();
+    if (worker) {
+        worker->wait();
+    }
+}
+
+void ScanSession::start(const QString &rootPath, bool shallow)
+{
+    if (worker) {
+        return;
+    }
+
+    scanRoot = rootPath;
+
+    // 结果在线程结束后才由 GUI 线程读取，QThread::finished 保证了可见性
+    worker = QThread::create([this, rootPath, shallow]() {
+        std::shared_ptr<ScannedTree> snapshot;
+        if (useSnapshotCache) {
+            snapshot = snapshotCache.load(rootPath, dirTree.sourceKey(rootPath));
+        }
+        
+        // 有快照时即使层级视图只需要一层，也直接得到完整的树
+        std::shared_ptr<ScannedTree> source;
+        if (snapshot) {
+            restored = true;
+            source = dirTree.revalidate(*snapshot);
+        } else {
+            source = dirTree.scanSource(rootPath, shallow);
+        }
+        if (dirTree.isCancelled()) {
+            return;
+        }
+        scanSource = source;
+        scanResult = dirTree.project(*source);
+        
+        // 完整的超集树写回磁盘；从快照恢复且没有任何目录变化时不必重写
+        if (useSnapshotCache && source->complete && (!snapshot || dirTree.getRelistedDirectories() > 0)) {
+            snapshotCache.save(*source);
+        }
+    });
+    worker->setParent(this);
+    connect(worker, &QThread::finished, this, &ScanSession::onWorkerFinished);
+
+    elapsed.start();
+    progressTimer->start();
+    worker->start();
+}
+
+void ScanSession::setSnapshotCache(const ScanCache &cache)
+{
+    snapshotCache = cache;
+    useSnapshotCache = true;
+}
+
+void ScanSession::cancel()
+{
+    dirTree.requestCancel();
+}
+
+void ScanSession::discard()
+{
+    cancel();
+    discarded = true;
+    progressTimer->stop();
+    // 线程仍在运行时由 onWorkerFinished 销毁；两者都在 GUI 线程中执行，不会错过线程结束
+    if (!worker || workerDone) {
+        deleteLater();
+    }
+}
+
+bool ScanSession::isRunning() const
+{
+    return worker && worker->isRunning();
+}
+
+bool ScanSession::isCancelled() const
+{
+    return dirTree.isCancelled();
+}
+
+void ScanSession::reportProgress()
+{
+    lastProgress = dirTree.progress();
+    lastProgress.elapsedMs = elapsed.elapsed();
+    estimateRemaining(lastProgress);
+    emit progressChanged(lastProgress);
+}
+
+void ScanSession::onWorkerFinished()
+{
+    workerDone = true;
+    if (discarded) {
+        deleteLater();
+        return;
+    }
+
+    progressTimer->stop();
+    reportProgress();
+
+    if (dirTree.isCancelled()) {
+        emit cancelled();
+    } else {
+        emit finished();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef SCANSESSION_H
+#define SCANSESSION_H
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <memory>
+#include "DirectoryTree.h"
+#include "ScanCache.h"
+
+// 一次目录扫描会话：在工作线程中运行 DirectoryTree，
+// 通过排队信号把进度和完成通知送回 GUI 线程，并支持中途取消
+class ScanSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ScanSession(QObject *parent = nullptr);
+    ~ScanSession() override;
+
+    // 扫描开始前通过它配置选项
+    DirectoryTree &tree() { return dirTree; }
+    // 启用磁盘缓存：有快照时只重新验证，完整的扫描结果写回缓存
+    void setSnapshotCache(const ScanCache &cache);
+
+    // shallow 为 true 时只读取根目录一层，供层级视图按需展开
+    void start(const QString &rootPath, bool shallow = false);
+    void cancel();
+    // 取消扫描并在工作线程退出后自行销毁。不等待线程：卡在网络文件系统上的系统调用可能很久才返回，
+    // 在 GUI 线程中等待会冻结界面。调用后不应再使用这个对象
+    void discard();
+    bool isRunning() const;
+    bool isCancelled() const;
+    QString rootPath() const { return scanRoot; }
+    
+    // 扫描完成（finished 信号发出）后的结果：按当前选项投影出的树，以及它来自的超集树
+    std::shared_ptr<ScannedTree> result() const { return scanResult; }
+    std::shared_ptr<ScannedTree> source() const { return scanSource; }
+    // 最近一次报告的进度
+    ScanProgress progress() const { return lastProgress; }
+    // 结果是否由磁盘快照重新验证得到，以及期间重新读取的目录数
+    bool restoredFromSnapshot() const { return restored; }
+    qint64 relistedDirectories() const { return dirTree.getRelistedDirectories(); }
+
+signals:
+    void progressChanged(const ScanProgress &progress);
+    void cancelled();
+    void finished();
+
+private:
+    DirectoryTree dirTree;
+    QThread *worker;
+    QTimer *progressTimer;
+    QElapsedTimer elapsed;
+    ScanProgress lastProgress;
+    QString scanRoot;
+    std::shared_ptr<ScannedTree> scanResult;
+    std::shared_ptr<ScannedTree> scanSource;
+    ScanCache snapshotCache;
+    bool useSnapshotCache = false;
+    bool restored = false;
+    bool workerDone = false;
+    bool discarded = false;
+
+    void reportProgress();
+    void onWorkerFinished();
+};
+
+#endif // SCANSESSION_H
\ No newline at end of file
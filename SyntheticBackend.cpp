@@ -0,0 +1,246 @@
+#include "SyntheticBackend.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <chrono>
+#include <thread>
+#include "ScanProfiler.h"
+
+namespace {
+
+enum Operation : uint {
+    LIST_OPERATION = 1,
+    STAT_OPERATION = 2
+};
+
+QString normalizedPath(const QString &path)
+{
+    QString clean = QDir::cleanPath(path);
+    int start = 0;
+    while (start < clean.size() && clean.at(start) == '/') {
+        ++start;
+    }
+    clean = clean.mid(start);
+    return clean == "." ? QString() : clean;
+}
+
+}
+
+std::shared_ptr<const SyntheticFileSystem> SyntheticFileSystem::load(const QString &fileName, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) {
+            *errorString = file.errorString();
+        }
+        return nullptr;
+    }
+
+    auto fileSystem = std::make_shared<SyntheticFileSystem>();
+    fileSystem->fileModifiedTime = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+    Node root;
+    root.dir = true;
+    fileSystem->nodes.append(root);
+    fileSystem->byPath.insert(QString(), 0);
+
+    QVector<int> mountRoots;
+    int lineNumber = 0;
+    while (!file.atEnd()) {
+        ++lineNumber;
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        // 类型和两个数值之后的部分都是路径，路径中可以有空格
+        const int first = line.indexOf(' ');
+        const int second = first < 0 ? -1 : line.indexOf(' ', first + 1);
+        const char type = line.at(0);
+        bool ok = first == 1;
+        qint64 value = ok ? line.mid(first + 1, (second < 0 ? line.size() : second) - first - 1).toLongLong(&ok) : 0;
+        QString path;
+        qint64 statMicros = 0;
+        if (ok && type == 'm') {
+            const int third = second < 0 ? -1 : line.indexOf(' ', second + 1);
+            statMicros = third < 0 ? 0 : line.mid(second + 1, third - second - 1).toLongLong(&ok);
+            path = third < 0 ? QString() : normalizedPath(QString::fromUtf8(line.mid(third + 1)));
+        } else if (second >= 0) {
+            path = normalizedPath(QString::fromUtf8(line.mid(second + 1)));
+        }
+        if (!ok || (type == 'm' && (value < 0 || statMicros < 0))) {
+            if (errorString) {
+                *errorString = QString("第 %1 行格式不正确").arg(lineNumber);
+            }
+            return nullptr;
+        }
+        // find 输出的第一行是树根本身
+        if (path.isEmpty()) {
+            continue;
+        }
+
+        if (type == 'd') {
+            fileSystem->ensurePath(path, true);
+        } else if (type == 'f') {
+            fileSystem->nodes[fileSystem->ensurePath(path, false)].size = qMax<qint64>(0, value);
+        } else if (type == 'm') {
+            int index = fileSystem->ensurePath(path, true);
+            SyntheticLatency mountLatency;
+            mountLatency.listMicros = value;
+            mountLatency.statMicros = statMicros;
+            fileSystem->mountLatencies.append(mountLatency);
+            fileSystem->nodes[index].device = fileSystem->mountLatencies.size();
+            mountRoots.append(index);
+        }
+    }
+
+    // 上级节点总是先于下级创建，按编号顺序一次即可把挂载点的设备传给其下所有条目
+    QVector<bool> isMountRoot(fileSystem->nodes.size(), false);
+    for (int index : mountRoots) {
+        isMountRoot[index] = true;
+    }
+    for (int i = 1; i < fileSystem->nodes.size(); ++i) {
+        Node &node = fileSystem->nodes[i];
+        if (!isMountRoot[i]) {
+            node.device = fileSystem->nodes[node.parent].device;
+        }
+    }
+    return fileSystem;
+}
+
+int SyntheticFileSystem::ensurePath(const QString &path, bool dir)
+{
+    auto it = byPath.constFind(path);
+    if (it != byPath.constEnd()) {
+        return it.value();
+    }
+
+    int slash = path.lastIndexOf('/');
+    int parent = slash < 0 ? 0 : ensurePath(path.left(slash), true);
+    // 描述文件中作为文件出现过、又有下级条目的路径按目录处理
+    nodes[parent].dir = true;
+
+    Node node;
+    node.name = path.mid(slash + 1);
+    node.parent = parent;
+    node.dir = dir;
+    int index = nodes.size();
+    nodes.append(node);
+    nodes[parent].children.append(index);
+    byPath.insert(path, index);
+    return index;
+}
+
+int SyntheticFileSystem::find(const QString &path) const
+{
+    return byPath.value(normalizedPath(path), -1);
+}
+
+const SyntheticLatency *SyntheticFileSystem::deviceLatency(int device) const
+{
+    return device > 0 && device <= mountLatencies.size() ? &mountLatencies[device - 1] : nullptr;
+}
+
+SyntheticBackend::SyntheticBackend(std::shared_ptr<const SyntheticFileSystem> fileSystem,
+                                   const SyntheticLatency &latency, bool followSymlinks)
+    : FileSystemBackend(followSymlinks), fileSystem(std::move(fileSystem)), latency(latency)
+{
+}
+
+const SyntheticLatency &SyntheticBackend::latencyOf(int node) const
+{
+    const SyntheticLatency *mount = fileSystem->deviceLatency(fileSystem->node(node).device);
+    return mount ? *mount : latency;
+}
+
+void SyntheticBackend::delay(qint64 micros, const QString &path, uint operation) const
+{
+    if (latency.jitterMicros > 0) {
+        micros += qint64(qHash(path, latency.seed ^ (operation * 0x9E3779B9u)) % quint64(latency.jitterMicros + 1));
+    }
+    if (micros > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(micros));
+    }
+}
+
+void SyntheticBackend::fillEntry(int node, DirEntry &entry) const
+{
+    const SyntheticFileSystem::Node &item = fileSystem->node(node);
+    entry.name = item.name;
+    entry.type = item.dir ? EntryType::DIRECTORY : EntryType::FILE;
+    entry.hidden = item.name.startsWith('.');
+    entry.modifiedTime = fileSystem->modifiedTime();
+    entry.size = item.dir ? 0 : item.size;
+    entry.allocatedSize = (entry.size + 4095) / 4096 * 4096;
+    entry.id.device = quint64(item.device);
+    entry.id.inode = quint64(node) + 1;
+    entry.linkCount = 1;
+    entry.hasMetadata = true;
+}
+
+bool SyntheticBackend::listDirectory(const QString &path, bool showHidden, bool needMetadata,
+                                     QVector<DirEntry> &entries)
+{
+    int index = fileSystem->find(path);
+    {
+        ProfileScope listScope(ProfilePhase::LIST);
+        delay(index >= 0 ? latencyOf(index).listMicros : latency.listMicros, path, LIST_OPERATION);
+    }
+    if (index < 0 || !fileSystem->node(index).dir) {
+        return false;
+    }
+
+    const QVector<int> &children = fileSystem->node(index).children;
+    if (needMetadata && !children.isEmpty()) {
+        // 逐个 stat 的延迟一次休眠完，抖动只加一次
+        ProfileScope statScope(ProfilePhase::STAT, children.size());
+        delay(latencyOf(index).statMicros * children.size(), path, STAT_OPERATION);
+    }
+
+    ProfileScope stringsScope(ProfilePhase::STRINGS, children.size());
+    entries.reserve(entries.size() + children.size());
+    for (int child : children) {
+        DirEntry entry;
+        fillEntry(child, entry);
+        if (entry.hidden && !showHidden) {
+            continue;
+        }
+        if (!needMetadata) {
+            entry.modifiedTime = 0;
+            entry.size = 0;
+            entry.allocatedSize = 0;
+            entry.hasMetadata = false;
+        }
+        entries.append(entry);
+    }
+    return true;
+}
+
+bool SyntheticBackend::directoryModifiedTime(const QString &path, qint64 &modifiedTime, FileId *id)
+{
+    DirEntry entry;
+    if (!statEntry(path, entry) || !entry.isDir()) {
+        return false;
+    }
+
+    modifiedTime = entry.modifiedTime;
+    if (id) {
+        *id = entry.id;
+    }
+    return true;
+}
+
+bool SyntheticBackend::statEntry(const QString &path, DirEntry &entry)
+{
+    int index = fileSystem->find(path);
+    delay(index >= 0 ? latencyOf(index).statMicros : latency.statMicros, path, STAT_OPERATION);
+    if (index < 0) {
+        return false;
+    }
+
+    fillEntry(index, entry);
+    if (index == 0) {
+        entry.name = QFileInfo(path).fileName();
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef SYNTHETICBACKEND_H
+#define SYNTHETICBACKEND_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include "FileSystemBackend.h"
+
+// 注入的延迟（微秒）。每次调用的抖动由路径和种子散列得到，与线程调度无关，同样的输入总是得到同样的延迟
+struct SyntheticLatency {
+    qint64 listMicros = 0;      // 每次列出目录
+    qint64 statMicros = 0;      // 每个需要元数据的条目（逐个 stat），以及单独获取目录或条目的元数据
+    qint64 jitterMicros = 0;    // 每次调用额外增加 [0, jitterMicros] 的延迟
+    uint seed = 0;
+};
+
+// 由描述文件载入的只读内存目录树，可被多个后端实例和线程共享。描述文件每行一个条目：
+//     d <大小> <路径>             目录（大小忽略）
+//     f <大小> <路径>             文件
+//     m <列出延迟> <stat 延迟> <路径>   挂载点：该目录及其下的条目位于单独的设备上，使用自己的延迟（微秒）
+// 路径相对于树根，以 / 分隔，可以包含空格；缺少的上级目录自动补上。空行和 # 开头的行忽略，
+// 其他类型（符号链接、设备文件等）与真实后端一样跳过。
+// 可以直接用 find ROOT -printf '%y %s %P\n' 从真实目录生成
+class SyntheticFileSystem
+{
+public:
+    struct Node {
+        QString name;
+        int parent = -1;
+        bool dir = false;
+        qint64 size = 0;
+        int device = 0;         // 0 为根设备，每个挂载点一个新设备
+        QVector<int> children;
+    };
+
+    // 失败时返回 nullptr，errorString 给出原因和行号
+    static std::shared_ptr<const SyntheticFileSystem> load(const QString &fileName, QString *errorString = nullptr);
+
+    // 路径以 / 分隔，开头的 / 可有可无，"/" 为树根。不存在时返回 -1
+    int find(const QString &path) const;
+    const Node &node(int index) const { return nodes[index]; }
+    int size() const { return nodes.size(); }
+    // 所有条目的修改时间都取描述文件的修改时间，重新验证时整棵树都不会变化
+    qint64 modifiedTime() const { return fileModifiedTime; }
+    // 设备的延迟；根设备返回 nullptr，使用后端的默认值
+    const SyntheticLatency *deviceLatency(int device) const;
+
+private:
+    QVector<Node> nodes;
+    QHash<QString, int> byPath;     // 规范化的相对路径，树根为空字符串
+    QVector<SyntheticLatency> mountLatencies;  // 下标为设备号减一
+    qint64 fileModifiedTime = 0;
+
+    int ensurePath(const QString &path, bool dir);
+};
+
+// 在内存目录树上实现的扫描后端，每次调用前按设置的延迟休眠，用于在本机上复现 NFS 等高延迟存储，
+// 并以确定的方式测试调度、并发和缓存的变化
+class SyntheticBackend : public FileSystemBackend
+{
+public:
+    SyntheticBackend(std::shared_ptr<const SyntheticFileSystem> fileSystem, const SyntheticLatency &latency,
+                     bool followSymlinks = false);
+
+    bool listDirectory(const QString &path, bool showHidden, bool needMetadata,
+                       QVector<DirEntry> &entries) override;
+    bool directoryModifiedTime(const QString &path, qint64 &modifiedTime, FileId *id = nullptr) override;
+    bool statEntry(const QString &path, DirEntry &entry) override;
+
+private:
+    std::shared_ptr<const SyntheticFileSystem> fileSystem;
+    SyntheticLatency latency;
+
+    const SyntheticLatency &latencyOf(int node) const;
+    // 休眠 micros 加上由 path 和 operation 决定的抖动
+    void delay(qint64 micros, const QString &path, uint operation) const;
+    void fillEntry(int node, DirEntry &entry) const;
+};
+
+#endif // SYNTHETICBACKEND_H
@@ -0,0 +1,61 @@
+#include "TreeCache.h"
+
+TreeCache::TreeCache(int capacity)
+    : capacity(qMax(1, capacity))
+{
+}
+
+std::shared_ptr<ScannedTree> TreeCache::find(const QString &rootPath)
+{
+    auto it = trees.constFind(rootPath);
+    if (it == trees.constEnd()) {
+        return nullptr;
+    }
+
+    recentRoots.removeAll(rootPath);
+    recentRoots.prepend(rootPath);
+    return it.value();
+}
+
+void TreeCache::insert(const std::shared_ptr<ScannedTree> &tree)
+{
+    const QString &rootPath = tree->rootPath;
+    trees.insert(rootPath, tree);
+    recentRoots.removeAll(rootPath);
+    recentRoots.prepend(rootPath);
+
+    // 超出容量时淘汰最久未使用的树
+    while (recentRoots.size() > capacity) {
+        trees.remove(recentRoots.takeLast());
+    }
+}
+
+void TreeCache::remove(const QString &rootPath)
+{
+    trees.remove(rootPath);
+    recentRoots.removeAll(rootPath);
+}
+
+void TreeCache::clear()
+{
+    trees.clear();
+    recentRoots.clear();
+}
+
+size_t TreeCache::memoryUsage() const
+{
+    size_t total = 0;
+    for (const auto &tree : trees) {
+        total += tree->nodes.memoryUsage();
+    }
+    return total;
+}
+
+void TreeCache::trim(size_t bytes)
+{
+    size_t total = memoryUsage();
+    while (total > bytes && !recentRoots.isEmpty()) {
+        std::shared_ptr<ScannedTree> tree = trees.take(recentRoots.takeLast());
+        total -= tree->nodes.memoryUsage();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef TREECACHE_H
+#define TREECACHE_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include "DirectoryTree.h"
+
+// 扫描得到的超集树的内存缓存，按根路径保存最近使用的若干棵树。
+// 切换目录、修改选项时直接从中投影出结果，只有显式刷新或超集树不能覆盖新选项时才会重新访问磁盘
+class TreeCache
+{
+public:
+    explicit TreeCache(int capacity = 4);
+
+    // 能否用于当前选项由调用方通过 DirectoryTree::covers 判断
+    std::shared_ptr<ScannedTree> find(const QString &rootPath);
+    void insert(const std::shared_ptr<ScannedTree> &tree);
+    void remove(const QString &rootPath);
+    void clear();
+    
+    // 缓存的树共占用的内存
+    size_t memoryUsage() const;
+    // 按最久未使用的顺序淘汰，直到占用不超过 bytes。被淘汰的树如果保存过磁盘快照，
+    // 下次打开时从快照载入并只重新读取有变化的目录
+    void trim(size_t bytes);
+
+private:
+    int capacity;
+    QHash<QString, std::shared_ptr<ScannedTree>> trees;
+    QStringList recentRoots;  // 最近使用的在前
+};
+
+#endif // TREECACHE_H
\ No newline at end of file
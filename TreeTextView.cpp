@@ -0,0 +1,377 @@
+#include "TreeTextView.h"
+#include <QApplication>
+#include <QClipboard>
+#include <QContextMenuEvent>
+#include <QKeyEvent>
+#include <QMenu>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <algorithm>
+
+namespace {
+
+const int TEXT_MARGIN = 4;
+
+}
+
+TreeTextView::TreeTextView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+{
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setBackgroundRole(QPalette::Base);
+    viewport()->setAutoFillBackground(true);
+    viewport()->setCursor(Qt::IBeamCursor);
+}
+
+void TreeTextView::setTree(const std::shared_ptr<ScannedTree> &tree, const DirectoryTree *renderer)
+{
+    this->tree = tree;
+    this->renderer = renderer;
+    anchorLine = -1;
+    cursorLine = -1;
+    buildLineIndex();
+
+    verticalScrollBar()->setValue(0);
+    horizontalScrollBar()->setValue(0);
+    updateScrollBars();
+    viewport()->update();
+}
+
+void TreeTextView::clear()
+{
+    setTree(nullptr, nullptr);
+}
+
+void TreeTextView::setPlaceholderText(const QString &text)
+{
+    placeholderText = text;
+    viewport()->update();
+}
+
+void TreeTextView::buildLineIndex()
+{
+    lines.clear();
+    lineOfNode.clear();
+    estimatedColumns = 0;
+    contentWidth = 0;
+    if (!tree || !renderer) {
+        return;
+    }
+
+    const NodeStore &nodes = tree->nodes;
+    lines.reserve(size_t(nodes.size()));
+    lines.push_back(tree->root);
+    estimatedColumns = nodes.nameLength(tree->root);
+    collectLines(tree->root, 0, lines);
+    indexLines(0, int(lines.size()));
+}
+
+void TreeTextView::indexLines(int from, int to)
+{
+    // 替换子节点会在存储末尾追加新节点
+    lineOfNode.resize(size_t(tree->nodes.size()), -1);
+    for (int line = from; line < to; ++line) {
+        lineOfNode[lines[size_t(line)]] = line;
+    }
+}
+
+// 把 node 的所有后代按输出顺序追加到 out，node 本身位于 depth 层
+void TreeTextView::collectLines(NodeId node, int depth, std::vector<NodeId> &out)
+{
+    const NodeStore &nodes = tree->nodes;
+
+    // 非递归的先序遍历，栈中保存每层下一个要访问的子节点序号
+    struct Frame {
+        NodeId node;
+        int next;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({node, 0});
+
+    while (!stack.empty()) {
+        Frame &frame = stack.back();
+        if (frame.next >= nodes.childCount(frame.node)) {
+            stack.pop_back();
+            continue;
+        }
+
+        NodeId child = nodes.child(frame.node, frame.next++);
+        out.push_back(child);
+
+        // 按每层四个字符估计行宽，真实宽度在绘制时修正
+        int childDepth = depth + int(stack.size());
+        estimatedColumns = qMax(estimatedColumns, childDepth * 4 + 4 + nodes.nameLength(child));
+
+        if (nodes.childCount(child) > 0) {
+            stack.push_back({child, 0});
+        }
+    }
+}
+
+int TreeTextView::countDescendants(NodeId node) const
+{
+    const NodeStore &nodes = tree->nodes;
+    int count = 0;
+    std::vector<NodeId> stack;
+    stack.push_back(node);
+    while (!stack.empty()) {
+        NodeId dir = stack.back();
+        stack.pop_back();
+        count += nodes.childCount(dir);
+        for (int i = 0; i < nodes.childCount(dir); ++i) {
+            NodeId child = nodes.child(dir, i);
+            if (nodes.childCount(child) > 0) {
+                stack.push_back(child);
+            }
+        }
+    }
+    return count;
+}
+
+void TreeTextView::beginDirectoryChange(NodeId dir)
+{
+    // 监视到的每个变化都要定位一次，按节点编号直接查出所在行，不在全部行中查找
+    changingLine = dir < lineOfNode.size() ? lineOfNode[dir] : -1;
+    if (changingLine < 0) {
+        return;
+    }
+
+    changingSpan = countDescendants(dir);
+}
+
+void TreeTextView::endDirectoryChange(NodeId dir)
+{
+    if (changingLine < 0) {
+        return;
+    }
+
+    std::vector<NodeId> added;
+    collectLines(dir, tree->nodes.depth(dir), added);
+
+    auto first = lines.begin() + changingLine + 1;
+    for (auto it = first; it != first + changingSpan; ++it) {
+        lineOfNode[*it] = -1;
+    }
+    lines.erase(first, first + changingSpan);
+    lines.insert(lines.begin() + changingLine + 1, added.begin(), added.end());
+
+    // 变化区域之后的行整体移动；落在区域内的选区端点收回到目录所在行。
+    // 行数不变时只有新插入的行需要重新索引
+    int delta = int(added.size()) - changingSpan;
+    indexLines(changingLine + 1, delta == 0 ? changingLine + 1 + int(added.size()) : int(lines.size()));
+    auto adjust = [&](int &line) {
+        if (line > changingLine + changingSpan) {
+            line += delta;
+        } else if (line > changingLine) {
+            line = changingLine;
+        }
+    };
+    if (anchorLine >= 0) {
+        adjust(anchorLine);
+        adjust(cursorLine);
+    }
+
+    // 变化发生在可见区域之上时保持当前看到的内容不动
+    QScrollBar *bar = verticalScrollBar();
+    int top = bar->value();
+    updateScrollBars();
+    if (changingLine < top) {
+        adjust(top);
+        bar->setValue(top);
+    }
+
+    changingLine = -1;
+    viewport()->update();
+}
+
+void TreeTextView::remapNodes(const std::vector<NodeId> &oldToNew)
+{
+    for (NodeId &node : lines) {
+        node = oldToNew[node];
+    }
+    lineOfNode.clear();
+    indexLines(0, int(lines.size()));
+    viewport()->update();
+}
+
+int TreeTextView::lineHeight() const
+{
+    return viewport()->fontMetrics().lineSpacing();
+}
+
+int TreeTextView::lineAt(int y) const
+{
+    return verticalScrollBar()->value() + (y < 0 ? -1 : y / lineHeight());
+}
+
+void TreeTextView::updateScrollBars()
+{
+    int visibleLines = qMax(1, viewport()->height() / lineHeight());
+    verticalScrollBar()->setPageStep(visibleLines);
+    verticalScrollBar()->setSingleStep(1);
+    verticalScrollBar()->setRange(0, qMax(0, lineCount() - visibleLines));
+
+    QFontMetrics metrics = viewport()->fontMetrics();
+    int width = qMax(contentWidth, estimatedColumns * metrics.averageCharWidth()) + 2 * TEXT_MARGIN;
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setSingleStep(metrics.averageCharWidth());
+    horizontalScrollBar()->setRange(0, qMax(0, width - viewport()->width()));
+}
+
+void TreeTextView::paintEvent(QPaintEvent *)
+{
+    QPainter painter(viewport());
+    QFontMetrics metrics = viewport()->fontMetrics();
+    int height = lineHeight();
+
+    if (lines.empty()) {
+        painter.setPen(palette().color(QPalette::Disabled, QPalette::Text));
+        painter.drawText(TEXT_MARGIN, TEXT_MARGIN + metrics.ascent(), placeholderText);
+        return;
+    }
+
+    int first = verticalScrollBar()->value();
+    int last = qMin(lineCount() - 1, first + viewport()->height() / height + 1);
+    int x = TEXT_MARGIN - horizontalScrollBar()->value();
+    int selectionStart = qMin(anchorLine, cursorLine);
+    int selectionEnd = qMax(anchorLine, cursorLine);
+    int widest = contentWidth;
+
+    // 只为可见的行生成文本
+    for (int line = first; line <= last; ++line) {
+        int y = (line - first) * height;
+        QString text = renderer->renderLine(*tree, lines[size_t(line)]);
+
+        if (anchorLine >= 0 && line >= selectionStart && line <= selectionEnd) {
+            painter.fillRect(0, y, viewport()->width(), height, palette().highlight());
+            painter.setPen(palette().color(QPalette::HighlightedText));
+        } else {
+            painter.setPen(palette().color(QPalette::Text));
+        }
+        painter.drawText(x, y + metrics.ascent(), text);
+        widest = qMax(widest, metrics.horizontalAdvance(text));
+    }
+
+    // 遇到比估计更宽的行时扩大水平滚动范围
+    if (widest > contentWidth) {
+        contentWidth = widest;
+        updateScrollBars();
+    }
+}
+
+void TreeTextView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void TreeTextView::scrollContentsBy(int, int)
+{
+    viewport()->update();
+}
+
+void TreeTextView::changeEvent(QEvent *event)
+{
+    QAbstractScrollArea::changeEvent(event);
+    if (event->type() == QEvent::FontChange) {
+        contentWidth = 0;
+        updateScrollBars();
+    }
+}
+
+void TreeTextView::ensureLineVisible(int line)
+{
+    QScrollBar *bar = verticalScrollBar();
+    if (line < bar->value()) {
+        bar->setValue(line);
+    } else if (line >= bar->value() + bar->pageStep()) {
+        bar->setValue(line - bar->pageStep() + 1);
+    }
+}
+
+void TreeTextView::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton || lines.empty()) {
+        QAbstractScrollArea::mousePressEvent(event);
+        return;
+    }
+
+    int line = qBound(0, lineAt(event->pos().y()), lineCount() - 1);
+    if (!(event->modifiers() & Qt::ShiftModifier) || anchorLine < 0) {
+        anchorLine = line;
+    }
+    cursorLine = line;
+    viewport()->update();
+}
+
+void TreeTextView::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!(event->buttons() & Qt::LeftButton) || anchorLine < 0) {
+        QAbstractScrollArea::mouseMoveEvent(event);
+        return;
+    }
+
+    // 拖动到视口外时逐行滚动
+    cursorLine = qBound(0, lineAt(event->pos().y()), lineCount() - 1);
+    ensureLineVisible(cursorLine);
+    viewport()->update();
+}
+
+void TreeTextView::keyPressEvent(QKeyEvent *event)
+{
+    if (event == QKeySequence::Copy) {
+        copy();
+        return;
+    }
+    if (event == QKeySequence::SelectAll) {
+        selectAll();
+        return;
+    }
+
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void TreeTextView::contextMenuEvent(QContextMenuEvent *event)
+{
+    QMenu menu(this);
+    QAction *copyAction = menu.addAction("复制", this, &TreeTextView::copy);
+    copyAction->setEnabled(hasSelection());
+    QAction *selectAllAction = menu.addAction("全选", this, &TreeTextView::selectAll);
+    selectAllAction->setEnabled(!lines.empty());
+    menu.exec(event->globalPos());
+}
+
+QString TreeTextView::selectedText() const
+{
+    if (anchorLine < 0) {
+        return QString();
+    }
+
+    QString text;
+    int start = qMin(anchorLine, cursorLine);
+    int end = qMax(anchorLine, cursorLine);
+    for (int line = start; line <= end; ++line) {
+        text += renderer->renderLine(*tree, lines[size_t(line)]);
+        text += '\n';
+    }
+    return text;
+}
+
+void TreeTextView::copy()
+{
+    if (hasSelection()) {
+        QApplication::clipboard()->setText(selectedText());
+    }
+}
+
+void TreeTextView::selectAll()
+{
+    if (lines.empty()) {
+        return;
+    }
+
+    anchorLine = 0;
+    cursorLine = lineCount() - 1;
+    viewport()->update();
+}
@@ -0,0 +1,77 @@
+#ifndef TREETEXTVIEW_H
+#define TREETEXTVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QString>
+#include <memory>
+#include <vector>
+#include "DirectoryTree.h"
+
+// 只读的按行虚拟化文本视图。
+// 只保存按输出顺序排列的节点编号，每行文本在绘制或复制时才由 DirectoryTree::renderLine 生成，
+// 因此无论树有多大，布局和内存都只与可见的行数有关。支持按行选择和复制
+class TreeTextView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit TreeTextView(QWidget *parent = nullptr);
+
+    // renderer 提供缩进和输出格式，调用方需保证它比视图活得长
+    void setTree(const std::shared_ptr<ScannedTree> &tree, const DirectoryTree *renderer);
+    void clear();
+    void setPlaceholderText(const QString &text);
+    std::shared_ptr<ScannedTree> currentTree() const { return tree; }
+
+    // 树在原处被修改前后调用：只替换该目录子树对应的那一段行，不重建整个索引
+    void beginDirectoryChange(NodeId dir);
+    void endDirectoryChange(NodeId dir);
+    // 存储整理后节点编号整体改变
+    void remapNodes(const std::vector<NodeId> &oldToNew);
+    // 行索引占用的内存
+    size_t memoryUsage() const { return lines.capacity() * sizeof(NodeId) + lineOfNode.capacity() * sizeof(int); }
+
+    bool isEmpty() const { return lines.empty(); }
+    int lineCount() const { return int(lines.size()); }
+    bool hasSelection() const { return anchorLine >= 0; }
+    QString selectedText() const;
+
+public slots:
+    void copy();
+    void selectAll();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
+    void changeEvent(QEvent *event) override;
+
+private:
+    std::shared_ptr<ScannedTree> tree;
+    const DirectoryTree *renderer = nullptr;
+    std::vector<NodeId> lines;   // 第 i 行对应的节点
+    std::vector<int> lineOfNode; // 按节点编号索引的所在行，不在视图中（被替换下来）的节点为 -1
+    int estimatedColumns = 0;    // 最长行的估计字符数，用于初始的水平滚动范围
+    int contentWidth = 0;        // 已知的最大行宽（像素），绘制时遇到更宽的行会增大
+    int anchorLine = -1;         // 选区起点，-1 表示没有选区
+    int cursorLine = -1;         // 选区终点
+    int changingLine = -1;       // 正在变化的目录所在行
+    int changingSpan = 0;        // 该目录变化前子树占用的行数
+    QString placeholderText;
+
+    void buildLineIndex();
+    void collectLines(NodeId node, int depth, std::vector<NodeId> &out);
+    // 为 [from, to) 中的行更新 lineOfNode
+    void indexLines(int from, int to);
+    int countDescendants(NodeId node) const;
+    void updateScrollBars();
+    int lineHeight() const;
+    int lineAt(int y) const;
+    void ensureLineVisible(int line);
+};
+
+#endif // TREETEXTVIEW_H
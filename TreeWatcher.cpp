@@ -0,0 +1,451 @@
+#include "TreeWatcher.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int COALESCE_INTERVAL_MS = 250;   // 第一个事件到达后等待多久再统一处理
+const int APPLY_BUDGET_MS = 30;         // 每次处理变化的时间预算
+const int WATCH_BUDGET_MS = 15;         // 每次添加监视的时间预算
+const int COMPACT_MIN_ORPHANS = 100000;
+
+// 节点是否仍能从根节点到达：被替换下来的节点虽然还在存储中，但已不在父目录的子节点范围内
+bool isLive(const ScannedTree &tree, NodeId node)
+{
+    const NodeStore &nodes = tree.nodes;
+    if (node >= NodeId(nodes.size())) {
+        return false;
+    }
+
+    while (node != tree.root) {
+        NodeId parent = nodes.parent(node);
+        if (parent == INVALID_NODE || node < nodes.firstChild(parent)
+            || node >= nodes.firstChild(parent) + NodeId(nodes.childCount(parent))) {
+            return false;
+        }
+        node = parent;
+    }
+    return true;
+}
+
+}
+
+TreeWatcher::TreeWatcher(QObject *parent)
+    : QObject(parent)
+{
+    coalesceTimer = new QTimer(this);
+    coalesceTimer->setSingleShot(true);
+    coalesceTimer->setInterval(COALESCE_INTERVAL_MS);
+    connect(coalesceTimer, &QTimer::timeout, this, &TreeWatcher::applyPendingChanges);
+
+    // 大量目录分批添加监视，每批之间让出事件循环
+    watchTimer = new QTimer(this);
+    watchTimer->setInterval(0);
+    connect(watchTimer, &QTimer::timeout, this, &TreeWatcher::addPendingWatches);
+}
+
+TreeWatcher::~TreeWatcher()
+{
+    stop();
+}
+
+bool TreeWatcher::isSupported()
+{
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TreeWatcher::watch(const std::shared_ptr<ScannedTree> &tree, DirectoryTree *lister)
+{
+    stop();
+    if (!tree || !lister || !isSupported()) {
+        return;
+    }
+
+#ifdef Q_OS_LINUX
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        // 实例数达到上限等情况下不监视，行为与关闭实时更新相同
+        return;
+    }
+
+    this->tree = tree;
+    this->lister = lister;
+    notifier = new QSocketNotifier(inotifyFd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &TreeWatcher::readEvents);
+
+    // 只监视已经读取过的目录，未读取的目录在展开时通过 addDirectory 加入
+    const NodeStore &nodes = tree->nodes;
+    std::vector<NodeId> stack;
+    stack.push_back(tree->root);
+    while (!stack.empty()) {
+        NodeId dir = stack.back();
+        stack.pop_back();
+        if (!nodes.isPopulated(dir)) {
+            continue;
+        }
+
+        pendingWatches.push_back(dir);
+        for (int i = 0; i < nodes.childCount(dir); ++i) {
+            NodeId child = nodes.child(dir, i);
+            if (nodes.isDir(child)) {
+                stack.push_back(child);
+            }
+        }
+    }
+    // 从栈顶取出，根目录最先添加
+    std::reverse(pendingWatches.begin(), pendingWatches.end());
+    watchTimer->start();
+#endif
+}
+
+void TreeWatcher::stop()
+{
+    watchTimer->stop();
+    coalesceTimer->stop();
+    delete notifier;
+    notifier = nullptr;
+
+#ifdef Q_OS_LINUX
+    // 关闭实例会一并移除其上的所有监视
+    if (inotifyFd >= 0) {
+        ::close(inotifyFd);
+    }
+#endif
+    inotifyFd = -1;
+
+    nodeByWatch.clear();
+    watchByNode.clear();
+    pendingWatches.clear();
+    dirtyDirectories.clear();
+    limited = false;
+    tree.reset();
+    lister = nullptr;
+}
+
+void TreeWatcher::setPaused(bool paused)
+{
+    this->paused = paused;
+    if (!paused && !dirtyDirectories.isEmpty()) {
+        coalesceTimer->start();
+    }
+}
+
+void TreeWatcher::addDirectory(NodeId node)
+{
+    if (tree && !watchByNode.contains(node)) {
+        addWatch(node);
+    }
+}
+
+bool TreeWatcher::addWatch(NodeId node)
+{
+#ifdef Q_OS_LINUX
+    if (limited) {
+        return false;
+    }
+
+    uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF
+                    | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+    // 按修改时间排序时文件内容或属性的变化也会改变顺序
+    if (lister->needsMetadata()) {
+        mask |= IN_MODIFY | IN_ATTRIB;
+    }
+
+    int wd = inotify_add_watch(inotifyFd, QFile::encodeName(tree->path(node)).constData(), mask);
+    if (wd < 0) {
+        // 达到 max_user_watches 后不再尝试，已添加的监视继续有效
+        if (errno == ENOSPC) {
+            limited = true;
+            pendingWatches.clear();
+            watchTimer->stop();
+            emit watchLimitReached();
+        }
+        return false;
+    }
+
+    nodeByWatch.insert(wd, node);
+    watchByNode.insert(node, wd);
+    return true;
+#else
+    Q_UNUSED(node);
+    return false;
+#endif
+}
+
+void TreeWatcher::removeWatches(NodeId node)
+{
+    // node 的子树已不可达但仍完整保存在存储中，逐个移除其中目录的监视
+    const NodeStore &nodes = tree->nodes;
+    std::vector<NodeId> stack;
+    stack.push_back(node);
+    while (!stack.empty()) {
+        NodeId dir = stack.back();
+        stack.pop_back();
+
+        auto it = watchByNode.find(dir);
+        if (it != watchByNode.end()) {
+#ifdef Q_OS_LINUX
+            inotify_rm_watch(inotifyFd, it.value());
+#endif
+            nodeByWatch.remove(it.value());
+            watchByNode.erase(it);
+        }
+        dirtyDirectories.remove(dir);
+
+        for (int i = 0; i < nodes.childCount(dir); ++i) {
+            NodeId child = nodes.child(dir, i);
+            if (nodes.isDir(child)) {
+                stack.push_back(child);
+            }
+        }
+    }
+}
+
+void TreeWatcher::addPendingWatches()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!pendingWatches.empty() && timer.elapsed() < WATCH_BUDGET_MS) {
+        NodeId node = pendingWatches.back();
+        pendingWatches.pop_back();
+        if (isLive(*tree, node) && !watchByNode.contains(node)) {
+            addWatch(node);
+        }
+    }
+
+    if (pendingWatches.empty()) {
+        watchTimer->stop();
+    }
+}
+
+void TreeWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    bool overflowed = false;
+
+    for (;;) {
+        ssize_t length = ::read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        for (char *p = buffer; p < buffer + length;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflowed = true;
+                continue;
+            }
+
+            auto it = nodeByWatch.find(event->wd);
+            if (it == nodeByWatch.end()) {
+                continue;
+            }
+            NodeId node = it.value();
+
+            // 监视已被内核移除（目录被删除或所在文件系统被卸载）
+            if (event->mask & IN_IGNORED) {
+                watchByNode.remove(node);
+                nodeByWatch.erase(it);
+                continue;
+            }
+
+            // 目录自身被删除或移走时由父目录的列表体现
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                if (node != tree->root) {
+                    markDirty(tree->nodes.parent(node));
+                }
+                continue;
+            }
+
+            markDirty(node);
+        }
+    }
+
+    if (overflowed) {
+        emit resyncRequired();
+    }
+#endif
+}
+
+void TreeWatcher::markDirty(NodeId node)
+{
+    dirtyDirectories.insert(node);
+    // 不在每个事件到达时重新计时，持续变化时也能按固定间隔更新
+    if (!coalesceTimer->isActive()) {
+        coalesceTimer->start();
+    }
+}
+
+void TreeWatcher::applyPendingChanges()
+{
+    if (paused || !tree) {
+        return;
+    }
+
+    // 扫描选项已经改变时不再修改旧树，等待新的扫描结果
+    if (lister->scanKey(tree->rootPath) != tree->scanKey) {
+        dirtyDirectories.clear();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int applied = 0;
+
+    while (!dirtyDirectories.isEmpty() && timer.elapsed() < APPLY_BUDGET_MS) {
+        auto it = dirtyDirectories.begin();
+        NodeId dir = *it;
+        dirtyDirectories.erase(it);
+
+        if (isLive(*tree, dir)) {
+            applyChange(dir);
+            ++applied;
+        }
+    }
+
+    // 超出预算的部分留到下一轮事件循环
+    if (!dirtyDirectories.isEmpty()) {
+        QTimer::singleShot(0, this, &TreeWatcher::applyPendingChanges);
+    }
+
+    if (applied > 0) {
+        compactIfNeeded();
+        emit changesApplied(applied);
+    }
+}
+
+void TreeWatcher::applyChange(NodeId dir)
+{
+    NodeStore &nodes = tree->nodes;
+
+    // 未读取的目录只在完整的树中补读（例如新出现的子目录），层级视图中留给按需展开
+    if (!nodes.isPopulated(dir) && !(tree->complete && lister->canPopulate(*tree, dir))) {
+        return;
+    }
+
+    // 先添加监视再读取，读取期间发生的变化不会漏掉
+    if (!watchByNode.contains(dir)) {
+        addWatch(dir);
+    }
+
+    QVector<DirEntry> entries = lister->relistChildren(*tree, dir);
+    NodeId oldFirst = nodes.firstChild(dir);
+    int oldCount = nodes.childCount(dir);
+
+    emit directoryAboutToChange(dir);
+
+    QVector<NodeId> previous;
+    NodeId first = nodes.replaceChildren(dir, entries, &previous);
+    // 目录及其上级的汇总大小和条目数随之更新，按大小或条目数排序时的键也保持最新
+    nodes.updateAggregates(dir);
+
+    // 沿用原子树的子目录换了编号，监视和待处理的记录跟着换过去
+    QHash<NodeId, NodeId> moved;
+    for (int i = 0; i < previous.size(); ++i) {
+        NodeId id = first + NodeId(i);
+        NodeId old = previous.at(i);
+
+        if (old == INVALID_NODE) {
+            if (entries.at(i).isDir() && tree->complete) {
+                markDirty(id);
+            }
+            continue;
+        }
+        if (!nodes.isDir(id)) {
+            continue;
+        }
+
+        moved.insert(old, id);
+        auto watch = watchByNode.find(old);
+        if (watch != watchByNode.end()) {
+            int wd = watch.value();
+            watchByNode.erase(watch);
+            watchByNode.insert(id, wd);
+            nodeByWatch.insert(wd, id);
+        }
+        if (dirtyDirectories.remove(old)) {
+            dirtyDirectories.insert(id);
+        }
+    }
+
+    // 消失的子目录（已删除或移出树外）不再监视
+    for (int i = 0; i < oldCount; ++i) {
+        NodeId old = oldFirst + NodeId(i);
+        if (nodes.isDir(old) && !moved.contains(old)) {
+            removeWatches(old);
+        }
+    }
+
+    if (!moved.isEmpty()) {
+        for (NodeId &node : pendingWatches) {
+            node = moved.value(node, node);
+        }
+    }
+
+    emit directoryChanged(dir, oldFirst, oldCount);
+}
+
+void TreeWatcher::compactIfNeeded()
+{
+    int orphaned = tree->nodes.orphanedCount();
+    if (orphaned < COMPACT_MIN_ORPHANS || orphaned < tree->nodes.size() / 2) {
+        return;
+    }
+
+    emit treeAboutToBeCompacted();
+
+    std::vector<NodeId> oldToNew;
+    NodeStore compacted = tree->nodes.compacted(tree->root, oldToNew);
+    tree->nodes = std::move(compacted);
+    tree->root = oldToNew[tree->root];
+
+    QHash<int, NodeId> watches;
+    watches.swap(nodeByWatch);
+    watchByNode.clear();
+    for (auto it = watches.cbegin(); it != watches.cend(); ++it) {
+        NodeId node = oldToNew[it.value()];
+        if (node == INVALID_NODE) {
+#ifdef Q_OS_LINUX
+            inotify_rm_watch(inotifyFd, it.key());
+#endif
+            continue;
+        }
+        nodeByWatch.insert(it.key(), node);
+        watchByNode.insert(node, it.key());
+    }
+
+    QSet<NodeId> dirty;
+    for (NodeId node : qAsConst(dirtyDirectories)) {
+        if (oldToNew[node] != INVALID_NODE) {
+            dirty.insert(oldToNew[node]);
+        }
+    }
+    dirtyDirectories.swap(dirty);
+
+    std::vector<NodeId> pending;
+    for (NodeId node : pendingWatches) {
+        if (oldToNew[node] != INVALID_NODE) {
+            pending.push_back(oldToNew[node]);
+        }
+    }
+    pendingWatches.swap(pending);
+
+    emit treeCompacted(oldToNew);
+}
@@ -0,0 +1,85 @@
+#ifndef TREEWATCHER_H
+#define TREEWATCHER_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QVector>
+#include <memory>
+#include <vector>
+#include "DirectoryTree.h"
+
+class QSocketNotifier;
+class QTimer;
+
+// 监视已扫描的目录（Linux 上使用 inotify），把新建、删除、重命名和修改直接应用到内存中的树上，
+// 不必重新扫描整个目录树。一段时间内的事件先合并，到期后只重新读取发生变化的目录，
+// 每次处理都有时间预算，大量变化会分几次完成，不会卡住界面。
+// 系统的监视数量达到上限时停止添加新的监视，已添加的继续生效。
+// 只在 GUI 线程中使用；树被其他线程读取（例如导出）期间应暂停
+class TreeWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TreeWatcher(QObject *parent = nullptr);
+    ~TreeWatcher() override;
+
+    static bool isSupported();
+
+    // 开始监视 tree 中已读取的目录。lister 用于重新读取目录，其选项应与生成 tree 时一致
+    void watch(const std::shared_ptr<ScannedTree> &tree, DirectoryTree *lister);
+    void stop();
+    bool isWatching() const { return tree != nullptr; }
+    std::shared_ptr<ScannedTree> watchedTree() const { return tree; }
+
+    // 暂停期间只记录发生变化的目录，恢复后再应用
+    void setPaused(bool paused);
+    // 层级视图按需读取了一个目录，开始监视它
+    void addDirectory(NodeId node);
+
+    int watchCount() const { return nodeByWatch.size(); }
+    bool isLimited() const { return limited; }
+
+signals:
+    // 目录的子节点即将被替换 / 已经替换。替换后原来的子节点编号不再可达，
+    // oldFirstChild 和 oldCount 描述替换前的子节点，仍可用于查询名称
+    void directoryAboutToChange(NodeId dir);
+    void directoryChanged(NodeId dir, NodeId oldFirstChild, int oldCount);
+    // 孤立节点过多时重新整理存储，所有节点编号都会改变
+    void treeAboutToBeCompacted();
+    void treeCompacted(const std::vector<NodeId> &oldToNew);
+    // 一批变化应用完毕
+    void changesApplied(int directories);
+    // 监视数量达到系统上限
+    void watchLimitReached();
+    // 事件队列溢出，丢失的变化只能通过重新扫描找回
+    void resyncRequired();
+
+private slots:
+    void readEvents();
+    void addPendingWatches();
+    void applyPendingChanges();
+
+private:
+    std::shared_ptr<ScannedTree> tree;
+    DirectoryTree *lister = nullptr;
+    int inotifyFd = -1;
+    QSocketNotifier *notifier = nullptr;
+    QTimer *coalesceTimer;
+    QTimer *watchTimer;
+    QHash<int, NodeId> nodeByWatch;
+    QHash<NodeId, int> watchByNode;
+    std::vector<NodeId> pendingWatches;  // 尚未添加监视的目录
+    QSet<NodeId> dirtyDirectories;       // 等待重新读取的目录
+    bool paused = false;
+    bool limited = false;
+
+    bool addWatch(NodeId node);
+    void removeWatches(NodeId node);
+    void markDirty(NodeId node);
+    void applyChange(NodeId dir);
+    void compactIfNeeded();
+};
+
+#endif // TREEWATCHER_H
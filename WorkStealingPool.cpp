@@ -0,0 +1,125 @@
+#include "WorkStealingPool.h"
+
+namespace {
+// 当前线程所属的线程池及其队列编号，用于把派生任务放进本线程队列
+thread_local WorkStealingPool *currentPool = nullptr;
+thread_local int currentIndex = -1;
+}
+
+WorkStealingPool::WorkStealingPool(int threadCount)
+    : pendingTasks(0), queuedTasks(0), nextQueue(0), stopping(false)
+{
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+
+    for (int i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task)
+{
+    int index;
+    if (currentPool == this) {
+        index = currentIndex;
+    } else {
+        index = static_cast<int>(nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size());
+    }
+
+    pendingTasks.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    queuedTasks.fetch_add(1, std::memory_order_release);
+
+    // 在 sleepMutex 下通知，避免与正准备休眠的线程错过唤醒
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeUp.notify_one();
+}
+
+void WorkStealingPool::waitForIdle()
+{
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    idle.wait(lock, [this]() { return pendingTasks.load(std::memory_order_acquire) == 0; });
+}
+
+bool WorkStealingPool::takeTask(int index, Task &task)
+{
+    // 先从自己的队尾取
+    {
+        WorkerQueue &own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // 再从其他线程的队首窃取
+    const int count = static_cast<int>(queues.size());
+    for (int offset = 1; offset < count; ++offset) {
+        WorkerQueue &victim = *queues[(index + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkStealingPool::workerLoop(int index)
+{
+    currentPool = this;
+    currentIndex = index;
+
+    while (true) {
+        Task task;
+        if (takeTask(index, task)) {
+            task();
+            task = nullptr;
+
+            if (pendingTasks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                idle.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this]() {
+            return stopping || queuedTasks.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping && queuedTasks.load(std::memory_order_acquire) == 0) {
+            break;
+        }
+    }
+
+    currentPool = nullptr;
+    currentIndex = -1;
+}
\ No newline at end of file
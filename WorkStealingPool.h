@@ -0,0 +1,54 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 工作窃取线程池：每个工作线程有自己的任务队列，
+// 自己从队尾取任务（深度优先，缓存友好），空闲时从其他线程的队首窃取
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(int threadCount);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // 在工作线程内提交的任务进入该线程自己的队列，否则轮流分配
+    void submit(Task task);
+
+    // 阻塞直到所有已提交的任务（包括任务中派生的任务）执行完毕
+    void waitForIdle();
+
+    int threadCount() const { return static_cast<int>(workers.size()); }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<int> pendingTasks;   // 已提交但尚未执行完的任务
+    std::atomic<int> queuedTasks;    // 仍在队列中等待执行的任务
+    std::atomic<unsigned> nextQueue;
+    std::atomic<bool> stopping;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::condition_variable idle;
+
+    void workerLoop(int index);
+    bool takeTask(int index, Task &task);
+};
+
+#endif // WORKSTEALINGPOOL_H
\ No newline at end of file